@@ -0,0 +1,430 @@
+// benchmark-app.cpp : Benchmarks of simple_thread wakeup latency, notify throughput, timer accuracy and scaling.
+//
+// Usage: benchmark-app [latency] [rate] [timer] [unlock] [scale] [--samples N] [--instances 1,100,10000]
+//        without benchmark names all benchmarks are run
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "simple_thread_wrapper.h"
+#include "simple_thread_metrics.h"
+#include "simple_thread_pool.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Compared implementations */
+enum class bench_mode
+{
+    thread_park,            // simple_thread, simple_thread_wait::park
+    thread_spin_then_park,  // simple_thread, simple_thread_wait::spin_then_park
+    thread_busy_spin,       // simple_thread, simple_thread_wait::busy_spin
+    pool,                   // simple_pool_thread on shared simple_thread_pool
+};
+
+const char * mode_name(bench_mode mode)
+{
+    switch (mode) {
+    case bench_mode::thread_park: return "thread park";
+    case bench_mode::thread_spin_then_park: return "thread spin_then_park";
+    case bench_mode::thread_busy_spin: return "thread busy_spin";
+    case bench_mode::pool: return "pool";
+    }
+    return "?";
+}
+
+const bench_mode all_modes[] = { bench_mode::thread_park, bench_mode::thread_spin_then_park, bench_mode::thread_busy_spin, bench_mode::pool };
+
+/* One workload of given mode, hides difference between simple_thread and simple_pool_thread */
+class bench_worker
+{
+public:
+    bench_worker(bench_mode mode, simple_thread_pool & pool)
+        : m_mode(mode)
+    {
+        if (mode == bench_mode::pool) {
+            m_pool_thread = std::make_unique<simple_pool_thread>(pool);
+        }
+        else {
+            m_thread = std::make_unique<simple_thread>();
+        }
+    }
+
+    void start(bench_clock::duration timeout, std::function<bool()> pred, std::function<void(simple_thread_context_intf &)> fx,
+        simple_thread_options options = simple_thread_options())
+    {
+        if (m_pool_thread) {
+            m_pool_thread->start(timeout, std::move(pred), std::move(fx));
+            return;
+        }
+        if (m_mode == bench_mode::thread_spin_then_park) {
+            options.wait = simple_thread_wait::spin_then_park;
+        }
+        else if (m_mode == bench_mode::thread_busy_spin) {
+            options.wait = simple_thread_wait::busy_spin;
+        }
+        m_thread->start(options, timeout, std::move(pred), std::move(fx));
+    }
+    void notify()
+    {
+        m_pool_thread ? m_pool_thread->notify() : m_thread->notify();
+    }
+    void request_stop()
+    {
+        if (m_thread) {
+            m_thread->request_stop();
+        }
+    }
+    void stop()
+    {
+        m_pool_thread ? m_pool_thread->stop() : m_thread->stop();
+    }
+
+private:
+    bench_mode                              m_mode;
+    std::unique_ptr<simple_thread>          m_thread;
+    std::unique_ptr<simple_pool_thread>     m_pool_thread;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Silent logger, "Stop requested" of thousands of workers would dominate measured time */
+class null_logger : public simple_thread_logger_intf
+{
+public:
+    void log(const char *) override {}
+};
+null_logger g_null_logger;
+
+simple_thread_options quiet_options()
+{
+    simple_thread_options options;
+    options.logger = &g_null_logger;
+    return options;
+}
+
+void print_header(const char * title)
+{
+    std::cout << "\n=== " << title << " ===\n";
+}
+
+void print_histogram(const std::string & name, const simple_thread_histogram & histogram, double scale = 1000.0, const char * unit = "us")
+{
+    const auto snapshot = histogram.snapshot();
+    std::cout << "  " << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(2)
+        << " n=" << std::setw(7) << snapshot.count()
+        << "  mean " << std::setw(9) << snapshot.mean() / scale
+        << "  p50 " << std::setw(9) << snapshot.percentile(50.0) / scale
+        << "  p99 " << std::setw(9) << snapshot.percentile(99.0) / scale
+        << "  p99.9 " << std::setw(9) << snapshot.percentile(99.9) / scale
+        << "  max " << std::setw(9) << snapshot.max() / scale << " " << unit << "\n";
+}
+
+/* Wait for condition with timeout, returns false on timeout */
+template <class _Fn>
+bool wait_for_condition(_Fn && condition, bench_clock::duration timeout = std::chrono::seconds(5))
+{
+    const auto end = bench_clock::now() + timeout;
+    while (!condition()) {
+        if (bench_clock::now() > end) {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* notify() to fx call latency, worker is idle (parked or spinning) before every notify */
+void bench_latency(size_t samples)
+{
+    print_header("notify to fx latency");
+    simple_thread_pool pool(1);
+    for (const bench_mode mode : all_modes) {
+        simple_thread_histogram histogram;
+        std::atomic<int64_t> sent_time = 0;
+        std::atomic_bool pending = false;
+        std::atomic<uint64_t> handled = 0;
+
+        bench_worker worker(mode, pool);
+        worker.start(std::chrono::seconds(10),
+            [&]() { return pending.load(); },
+            [&](simple_thread_context_intf &) {
+                if (pending.exchange(false)) {
+                    histogram.record(bench_clock::now().time_since_epoch() - bench_clock::duration(sent_time.load()));
+                    ++handled;
+                }
+            }, quiet_options());
+
+        bool ok = true;
+        for (size_t sample = 0; sample < samples && ok; ++sample) {
+            // give worker time to go idle, spin_then_park parks after its spin budget
+            std::this_thread::sleep_for(std::chrono::microseconds(sample % 2 ? 20 : 200));
+            sent_time.store(bench_clock::now().time_since_epoch().count());
+            pending.store(true);
+            worker.notify();
+            ok = wait_for_condition([&]() { return handled.load() == sample + 1; });
+        }
+        worker.stop();
+        print_histogram(mode_name(mode), histogram);
+        if (!ok) {
+            std::cout << "  " << mode_name(mode) << ": timeout, notification was lost\n";
+        }
+    }
+}
+
+/* Max notify() rate of one producer, worker consumes notifications */
+void bench_rate(bench_clock::duration duration)
+{
+    print_header("notify rate, one producer and one worker");
+    simple_thread_pool pool(1);
+    for (const bench_mode mode : all_modes) {
+        std::atomic_bool pending = false;
+        std::atomic<uint64_t> calls = 0;
+
+        bench_worker worker(mode, pool);
+        worker.start(std::chrono::seconds(10),
+            [&]() { return pending.load(); },
+            [&](simple_thread_context_intf &) {
+                pending.store(false);
+                ++calls;
+            }, quiet_options());
+
+        uint64_t notifications = 0;
+        const auto start = bench_clock::now();
+        const auto end = start + duration;
+        for (auto now = start; now < end; ) {
+            for (int i = 0; i < 256; ++i, ++notifications) {
+                pending.store(true, std::memory_order_relaxed);
+                worker.notify();
+            }
+            now = bench_clock::now();
+        }
+        const double seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+        worker.stop();
+        std::cout << "  " << std::left << std::setw(24) << mode_name(mode) << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << notifications / seconds / 1e6 << " M notify/s"
+            << std::setw(10) << calls.load() / seconds / 1e3 << " k fx calls/s\n";
+    }
+}
+
+/* Accuracy of periodic timeouts, relative and fixed_rate schedule, pool timer wheel */
+void bench_timer(size_t periods, bench_clock::duration period)
+{
+    print_header("timer accuracy (interval error against period)");
+    struct timer_case
+    {
+        const char *            name;
+        bench_mode              mode;
+        simple_thread_schedule  schedule;
+    };
+    const timer_case cases[] = {
+        { "thread relative", bench_mode::thread_park, simple_thread_schedule::relative },
+        { "thread fixed_rate", bench_mode::thread_park, simple_thread_schedule::fixed_rate },
+        { "pool (1ms wheel)", bench_mode::pool, simple_thread_schedule::relative },
+    };
+    simple_thread_pool pool(1);
+    for (const auto & item : cases) {
+        simple_thread_histogram error;
+        std::atomic<size_t> count = 0;
+        bench_clock::time_point first;
+        bench_clock::time_point last;
+
+        simple_thread_options options = quiet_options();
+        options.schedule = item.schedule;
+        bench_worker worker(item.mode, pool);
+        worker.start(period,
+            []() { return false; },
+            [&](simple_thread_context_intf &) {
+                const auto now = bench_clock::now();
+                if (count.load() > 0) {
+                    const auto interval = now - last;
+                    error.record(interval > period ? interval - period : period - interval);
+                }
+                else {
+                    first = now;
+                }
+                last = now;
+                ++count;
+            }, options);
+        wait_for_condition([&]() { return count.load() > periods; }, period * periods * 4 + std::chrono::seconds(1));
+        worker.stop();
+
+        print_histogram(item.name, error);
+        const auto drift = (last - first) - period * (count.load() - 1);
+        std::cout << "  " << std::left << std::setw(24) << "" << std::right << " drift after " << count.load() - 1 << " periods "
+            << std::chrono::duration<double, std::milli>(drift).count() << " ms\n";
+    }
+}
+
+/* Cost of ctx.unlock() / scoped_unlock() compared to plain unlock/lock of std::unique_lock */
+void bench_unlock(size_t iterations)
+{
+    print_header("unlock cost (unlock + lock back, uncontended)");
+    double holder_ns = 0;
+    double guard_ns = 0;
+    std::atomic_bool done = false;
+
+    simple_thread test;
+    std::atomic_bool run = false;
+    auto fx = [&](simple_thread_context_intf & ctx) {
+        if (!run.exchange(false)) {
+            return;
+        }
+        auto start = bench_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            auto holder = ctx.unlock();
+        }
+        holder_ns = std::chrono::duration<double, std::nano>(bench_clock::now() - start).count() / iterations;
+
+        start = bench_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            auto guard = ctx.scoped_unlock();
+        }
+        guard_ns = std::chrono::duration<double, std::nano>(bench_clock::now() - start).count() / iterations;
+        done = true;
+    };
+    test.start(quiet_options(), std::chrono::seconds(10), [&]() { return run.load(); }, fx);
+    run = true;
+    test.notify();
+    wait_for_condition([&]() { return done.load(); }, std::chrono::seconds(60));
+    test.stop();
+
+    std::mutex mutex;
+    std::unique_lock lck(mutex);
+    const auto start = bench_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        lck.unlock();
+        lck.lock();
+    }
+    const double plain_ns = std::chrono::duration<double, std::nano>(bench_clock::now() - start).count() / iterations;
+
+    std::cout << std::fixed << std::setprecision(1)
+        << "  std::unique_lock          " << std::setw(8) << plain_ns << " ns\n"
+        << "  ctx.unlock() (holder)     " << std::setw(8) << holder_ns << " ns\n"
+        << "  ctx.scoped_unlock()       " << std::setw(8) << guard_ns << " ns\n";
+}
+
+/* Start, notify all and stop many instances, spin modes are left out (they need a core per instance) */
+void bench_scale(const std::vector<size_t> & instances)
+{
+    print_header("scaling with instance count (start, notify all until all fx run, stop)");
+    for (const size_t count : instances) {
+        for (const bench_mode mode : { bench_mode::thread_park, bench_mode::pool }) {
+            simple_thread_pool pool;
+            std::vector<std::unique_ptr<bench_worker>> workers;
+            std::vector<std::atomic_bool> pending(count);
+            std::atomic<size_t> handled = 0;
+            workers.reserve(count);
+
+            auto start = bench_clock::now();
+            try {
+                for (size_t i = 0; i < count; ++i) {
+                    auto worker = std::make_unique<bench_worker>(mode, pool);
+                    auto & flag = pending[i];
+                    worker->start(std::chrono::seconds(30),
+                        [&flag]() { return flag.load(); },
+                        [&flag, &handled](simple_thread_context_intf &) {
+                            if (flag.exchange(false)) {
+                                ++handled;
+                            }
+                        }, quiet_options());
+                    workers.push_back(std::move(worker));
+                }
+            }
+            catch (const std::system_error & e) {
+                std::cout << "  " << std::left << std::setw(24) << mode_name(mode) << std::right << " " << count
+                    << " instances: failed after " << workers.size() << " (" << e.what() << ")\n";
+                for (auto & worker : workers) {
+                    worker->request_stop();
+                }
+                continue;
+            }
+            const auto start_time = bench_clock::now() - start;
+
+            start = bench_clock::now();
+            for (size_t i = 0; i < count; ++i) {
+                pending[i].store(true);
+                workers[i]->notify();
+            }
+            const bool ok = wait_for_condition([&]() { return handled.load() == count; }, std::chrono::seconds(30));
+            const auto notify_time = bench_clock::now() - start;
+
+            start = bench_clock::now();
+            for (auto & worker : workers) {
+                worker->request_stop();
+            }
+            workers.clear();
+            const auto stop_time = bench_clock::now() - start;
+
+            std::cout << "  " << std::left << std::setw(24) << mode_name(mode) << std::right << std::fixed << std::setprecision(2)
+                << std::setw(7) << count << " instances:"
+                << "  start " << std::setw(9) << std::chrono::duration<double, std::milli>(start_time).count() << " ms"
+                << "  notify all " << std::setw(9) << std::chrono::duration<double, std::milli>(notify_time).count() << " ms"
+                << "  stop " << std::setw(9) << std::chrono::duration<double, std::milli>(stop_time).count() << " ms"
+                << (ok ? "" : "  (not all fx called)") << "\n";
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char * argv[])
+{
+    std::vector<std::string> selected;
+    size_t samples = 10000;
+    std::vector<size_t> instances = { 1, 100, 10000 };
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--samples" && i + 1 < argc) {
+            samples = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--instances" && i + 1 < argc) {
+            instances.clear();
+            for (const char * item = argv[++i]; *item; ) {
+                char * end = nullptr;
+                instances.push_back(std::strtoull(item, &end, 10));
+                item = *end ? end + 1 : end;
+            }
+        }
+        else {
+            selected.push_back(arg);
+        }
+    }
+    auto enabled = [&](const char * name) {
+        return selected.empty() || std::find(selected.begin(), selected.end(), name) != selected.end();
+    };
+
+    std::cout << log_time() << " simple_thread benchmark, " << std::thread::hardware_concurrency() << " hardware threads\n";
+    if (enabled("latency")) {
+        bench_latency(samples);
+    }
+    if (enabled("rate")) {
+        bench_rate(std::chrono::seconds(1));
+    }
+    if (enabled("timer")) {
+        bench_timer(std::max<size_t>(samples / 10, 10), std::chrono::milliseconds(1));
+    }
+    if (enabled("unlock")) {
+        bench_unlock(samples * 100);
+    }
+    if (enabled("scale")) {
+        bench_scale(instances);
+    }
+    std::cout << log_time() << " Done\n";
+    return 0;
+}
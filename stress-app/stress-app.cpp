@@ -0,0 +1,919 @@
+// stress-app.cpp : Stress tests of lock-free structures, pool timer wheel, slab allocator and notify/stop races.
+//
+// Usage: stress-app [mpsc_queue] [ws_deque] [queue_thread] [pool_timer] [pool_notify] [fixed_rate] [executor] [trace] [async_logger] [slab] [notify_stop] [--scale N]
+//        without test names all tests are run, exit code is number of failed tests
+//        build with SIMPLE_THREAD_SANITIZER=thread to find data races
+//        [coro] is built only with C++20 (stress-app-cxx20 target)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+#include "simple_thread_wrapper.h"
+#include "simple_thread_alloc.h"
+#include "simple_thread_coro.h"
+#include "simple_thread_executor.h"
+#include "simple_thread_io.h"
+#include "simple_thread_pool.h"
+#include "simple_thread_queue.h"
+
+using stress_clock = std::chrono::steady_clock;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Silent logger, "Stop requested" of every restart would flood the output */
+class null_logger : public simple_thread_logger_intf
+{
+public:
+    void log(const char *) override {}
+};
+null_logger g_null_logger;
+
+simple_thread_options quiet_options()
+{
+    simple_thread_options options;
+    options.logger = &g_null_logger;
+    return options;
+}
+
+/* Failed checks of running test, any thread */
+std::atomic<size_t> g_failures = 0;
+
+void check(bool condition, const char * message)
+{
+    if (!condition) {
+        if (g_failures.fetch_add(1) < 10) {
+            std::cout << "  FAILED: " << message << "\n";
+        }
+    }
+}
+
+/* Wait for condition with timeout, returns false on timeout */
+template <class _Fn>
+bool wait_for_condition(_Fn && condition, stress_clock::duration timeout = std::chrono::seconds(10))
+{
+    const auto end = stress_clock::now() + timeout;
+    while (!condition()) {
+        if (stress_clock::now() > end) {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+size_t stress_threads()
+{
+    return std::clamp<size_t>(std::thread::hardware_concurrency(), 2, 8);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Producers push and push_batch tagged values, consumer checks that nothing is lost or duplicated,
+ * and that items of every producer come in FIFO order
+ */
+void stress_mpsc_queue(size_t scale)
+{
+    const size_t producers = stress_threads();
+    const uint64_t per_producer = 100000 * scale;
+    simple_thread_mpsc_queue<uint64_t> queue;
+    std::atomic_bool go = false;
+
+    std::vector<std::thread> threads;
+    for (uint64_t producer = 0; producer < producers; ++producer) {
+        threads.emplace_back([&, producer]() {
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            uint64_t batch[7];
+            for (uint64_t seq = 0; seq < per_producer; ) {
+                if (seq % 3 == 0) {
+                    queue.push((producer << 32) | seq++);
+                    continue;
+                }
+                size_t count = 0;
+                for (; count < 7 && seq < per_producer; ++count) {
+                    batch[count] = (producer << 32) | seq++;
+                }
+                queue.push_batch(batch, batch + count);
+            }
+        });
+    }
+
+    std::vector<uint64_t> next_seq(producers, 0);
+    uint64_t received = 0;
+    std::vector<uint64_t> items;
+    go.store(true);
+    const auto end = stress_clock::now() + std::chrono::seconds(60);
+    while (received < producers * per_producer && stress_clock::now() < end) {
+        uint64_t value = 0;
+        // alternate single pop and pop_all
+        if (received % 2 == 0 && queue.pop(value)) {
+            items.push_back(value);
+        }
+        else {
+            queue.pop_all(items);
+        }
+        for (uint64_t item : items) {
+            const size_t producer = static_cast<size_t>(item >> 32);
+            check(producer < producers && (item & 0xffffffff) == next_seq[producer], "mpsc item out of order or duplicated");
+            if (producer < producers) {
+                next_seq[producer] = (item & 0xffffffff) + 1;
+            }
+        }
+        received += items.size();
+        items.clear();
+    }
+    for (auto & thread : threads) {
+        thread.join();
+    }
+    check(received == producers * per_producer, "mpsc items lost");
+    check(queue.empty(), "mpsc queue not empty");
+}
+
+/* Owner pushes (deque grows from small capacity) and pops, thieves steal, every item must be taken exactly once */
+void stress_ws_deque(size_t scale)
+{
+    const size_t thieves = stress_threads() - 1;
+    const size_t item_count = 200000 * scale;
+    std::vector<std::atomic<uint32_t>> taken(item_count);
+    std::vector<size_t> values(item_count);
+    simple_thread_ws_deque<size_t *> deque(4);
+    std::atomic_bool done = false;
+    std::atomic<size_t> taken_count = 0;
+
+    auto take = [&](size_t * item) {
+        taken[static_cast<size_t>(item - values.data())].fetch_add(1, std::memory_order_relaxed);
+        taken_count.fetch_add(1, std::memory_order_relaxed);
+    };
+    std::vector<std::thread> threads;
+    for (size_t thief = 0; thief < thieves; ++thief) {
+        threads.emplace_back([&]() {
+            while (!done.load(std::memory_order_relaxed)) {
+                if (size_t * item = deque.steal()) {
+                    take(item);
+                }
+            }
+        });
+    }
+
+    for (size_t index = 0; index < item_count; ++index) {
+        deque.push(&values[index]);
+        // owner takes back about one third, races with thieves on the last item
+        if (index % 3 == 0) {
+            if (size_t * item = deque.pop()) {
+                take(item);
+            }
+        }
+    }
+    while (size_t * item = deque.pop()) {
+        take(item);
+    }
+    check(wait_for_condition([&]() { return taken_count.load() == item_count; }), "ws_deque items lost");
+    done.store(true);
+    for (auto & thread : threads) {
+        thread.join();
+    }
+    check(taken_count.load() == item_count, "ws_deque items taken more than once");
+    check(std::all_of(taken.begin(), taken.end(), [](const std::atomic<uint32_t> & count) { return count.load() == 1; }),
+        "ws_deque item not taken exactly once");
+    check(deque.empty(), "ws_deque not empty");
+}
+
+/* Producers post tagged jobs to queue thread whose fx throws once (error policy resumes), every job must be
+ * handed to fx exactly once, batch of failed call is not delivered again
+ */
+void stress_queue_thread(size_t scale)
+{
+    const size_t producers = stress_threads();
+    const size_t per_producer = 20000 * scale;
+    const size_t job_count = producers * per_producer;
+    std::vector<std::atomic<uint32_t>> seen(job_count);
+    std::atomic<size_t> seen_count = 0;
+    bool thrown = false;
+
+    simple_queue_thread<size_t> test;
+    test.start(quiet_options(), std::chrono::milliseconds(100), [&](simple_thread_context_intf &, std::vector<size_t> & batch) {
+        for (const size_t job : batch) {
+            seen[job].fetch_add(1, std::memory_order_relaxed);
+        }
+        seen_count.fetch_add(batch.size());
+        if (!batch.empty() && !thrown) {
+            thrown = true;
+            throw std::runtime_error("batch failed");
+        }
+    });
+    std::vector<std::thread> threads;
+    for (size_t producer = 0; producer < producers; ++producer) {
+        threads.emplace_back([&, producer]() {
+            for (size_t index = 0; index < per_producer; ++index) {
+                test.post(producer * per_producer + index);
+            }
+        });
+    }
+    for (auto & thread : threads) {
+        thread.join();
+    }
+    check(wait_for_condition([&]() { return seen_count.load() >= job_count; }), "queue thread jobs lost");
+    test.stop();
+    check(thrown, "queue thread fx did not throw");
+    check(seen_count.load() == job_count, "queue thread jobs delivered more than once");
+    check(std::all_of(seen.begin(), seen.end(), [](const std::atomic<uint32_t> & count) { return count.load() == 1; }),
+        "queue thread job not delivered exactly once");
+
+    // drop_oldest queue never exceeds capacity, so watermark above capacity never fires
+    simple_queue_options options;
+    options.capacity = 64;
+    options.overflow = simple_queue_overflow::drop_oldest;
+    options.high_watermark = options.capacity + 1;
+    std::atomic<size_t> watermarks = 0;
+    options.on_watermark = [&](bool, size_t) { watermarks.fetch_add(1); };
+    simple_queue_thread<size_t> bounded(options);
+    bounded.start(quiet_options(), std::chrono::milliseconds(100), [&](simple_thread_context_intf &, std::vector<size_t> &) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    });
+    threads.clear();
+    for (size_t producer = 0; producer < producers; ++producer) {
+        threads.emplace_back([&]() {
+            for (size_t index = 0; index < per_producer; ++index) {
+                bounded.post(index);
+            }
+        });
+    }
+    for (auto & thread : threads) {
+        thread.join();
+    }
+    bounded.stop();
+    check(watermarks.load() == 0, "queue thread watermark above capacity fired");
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+    const auto metrics = bounded.queue_metrics().snapshot();
+    check(metrics.depth.count() == job_count && metrics.depth.max() <= options.capacity, "queue thread depth metric is not depth after post");
+#endif
+}
+
+/* Many pool workloads with different timeouts (some re-armed by set_timeout), no timeout may fire early
+ * and every workload must fire
+ */
+void stress_pool_timer(size_t scale)
+{
+    const size_t workloads = 1000 * scale;
+    simple_thread_pool pool(4, std::chrono::milliseconds(1), &g_null_logger);
+    struct record
+    {
+        std::atomic<size_t>             m_fired = 0;
+        stress_clock::time_point        m_last_end;
+    };
+    std::vector<record> records(workloads);
+    std::vector<std::unique_ptr<simple_pool_thread>> threads;
+    for (size_t index = 0; index < workloads; ++index) {
+        threads.push_back(std::make_unique<simple_pool_thread>(pool, static_cast<int>(index % 3)));
+    }
+
+    const auto start = stress_clock::now();
+    for (size_t index = 0; index < workloads; ++index) {
+        const auto timeout = std::chrono::milliseconds(1 + index % 20);
+        records[index].m_last_end = stress_clock::now();
+        threads[index]->start(timeout, [&, index, timeout](simple_thread_context & ctx) {
+            record & item = records[index];
+            const auto now = stress_clock::now();
+            check(ctx.was_timeout(), "pool timer woke without timeout");
+            check(now >= item.m_last_end + ctx.get_timeout(), "pool timer fired before timeout");
+            // odd workloads alternate their timeout, re-arm must use the new one
+            if (index % 2 == 1) {
+                ctx.set_timeout(ctx.get_timeout() == timeout ? timeout * 2 : timeout);
+            }
+            item.m_fired.fetch_add(1, std::memory_order_relaxed);
+            item.m_last_end = stress_clock::now();
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    for (auto & thread : threads) {
+        thread->stop();
+    }
+    const auto elapsed = stress_clock::now() - start;
+    for (size_t index = 0; index < workloads; ++index) {
+        const size_t fired = records[index].m_fired.load();
+        check(fired > 0, "pool timer never fired");
+        // timeouts are round up to resolution, so there is upper bound of calls
+        check(static_cast<int64_t>(fired) <= elapsed / std::chrono::milliseconds(1 + index % 20) + 1, "pool timer fired too often");
+    }
+}
+
+/* notify() while fx runs, with pred false, re-queues workload, which must wait for its timeout again,
+ * not re-run fx immediately as timed out
+ */
+void stress_pool_notify(size_t scale)
+{
+    const auto timeout = std::chrono::milliseconds(20);
+    simple_thread_pool pool(2, std::chrono::milliseconds(1), &g_null_logger);
+    simple_pool_thread test(pool);
+    std::atomic<size_t> calls = 0;
+    stress_clock::time_point last_end = stress_clock::now();
+    test.start(timeout, [&](simple_thread_context & ctx) {
+        if (calls.load() > 0) {
+            check(stress_clock::now() >= last_end + timeout, "pool fx re-run before timeout after notify during fx");
+        }
+        check(ctx.was_timeout(), "pool fx woke by notify with false pred");
+        test.notify();
+        calls.fetch_add(1);
+        last_end = stress_clock::now();
+    });
+    check(wait_for_condition([&]() { return calls.load() >= 10 * scale; }), "pool timeout not fired");
+    test.stop();
+}
+
+/* fixed_rate schedule with fx overrun, missed periods are exactly the deadlines without own fx call (skip, coalesce),
+ * late periods called back to back (burst) are not missed
+ */
+void stress_fixed_rate(size_t scale)
+{
+    const auto period = std::chrono::milliseconds(2);
+    for (const auto overrun : { simple_thread_overrun::burst, simple_thread_overrun::skip, simple_thread_overrun::coalesce }) {
+        struct call
+        {
+            stress_clock::time_point    m_scheduled;
+            uint64_t                    m_missed;
+        };
+        std::vector<call> calls;
+        calls.reserve(64 * scale);
+        simple_thread_options options = quiet_options();
+        options.schedule = simple_thread_schedule::fixed_rate;
+        options.overrun = overrun;
+        std::atomic_bool finished = false;
+        simple_thread test;
+        test.start(options, period, [&](simple_thread_context & ctx) {
+            if (calls.size() == calls.capacity()) {
+                finished.store(true);
+                return;
+            }
+            calls.push_back(call{ ctx.get_scheduled_time(), ctx.get_missed_periods() });
+            // overrun of several periods, every 16th call
+            if (calls.size() % 16 == 1) {
+                std::this_thread::sleep_for(period * 5 + period / 2);
+            }
+        });
+        check(wait_for_condition([&]() { return finished.load(); }), "fixed_rate calls not finished");
+        test.stop();
+        for (size_t index = 1; index < calls.size(); ++index) {
+            const auto distance = (calls[index].m_scheduled - calls[index - 1].m_scheduled) / period;
+            if (overrun == simple_thread_overrun::burst) {
+                check(distance == 1 && calls[index].m_missed == 0, "fixed_rate burst period skipped or counted as missed");
+            }
+            else {
+                check(distance >= 1 && calls[index].m_missed == static_cast<uint64_t>(distance - 1), "fixed_rate missed periods do not match deadlines");
+            }
+        }
+    }
+}
+
+/* Threads spawn tasks to shared executor, tasks spawn nested groups and wait for them (group on task stack is
+ * destroyed right after wait), every task must run once, wait_all() must rethrow exception of the group
+ */
+void stress_executor(size_t scale)
+{
+    const size_t thread_count = stress_threads();
+    const size_t calls = 200 * scale;
+    const size_t tasks = 16;
+    const size_t nested = 4;
+    simple_thread_executor executor(stress_threads());
+    std::atomic<size_t> runs = 0;
+    std::atomic<size_t> rethrown = 0;
+    std::atomic<size_t> finished = 0;
+
+    std::vector<std::unique_ptr<simple_thread>> threads;
+    for (size_t thread = 0; thread < thread_count; ++thread) {
+        simple_thread_options options = quiet_options();
+        options.executor = &executor;
+        auto test = std::make_unique<simple_thread>();
+        test->start(options, std::chrono::milliseconds(0), [&, call = size_t(0)](simple_thread_context & ctx) mutable {
+            if (call == calls) {
+                ctx.set_timeout(std::chrono::hours(1));
+                return;
+            }
+            const bool throws = ++call % 8 == 0;
+            for (size_t task = 0; task < tasks; ++task) {
+                ctx.spawn([&, task]() {
+                    simple_task_group group;
+                    for (size_t index = 0; index < nested; ++index) {
+                        executor.spawn(group, [&]() { runs.fetch_add(1, std::memory_order_relaxed); });
+                    }
+                    executor.wait(group);
+                    runs.fetch_add(1, std::memory_order_relaxed);
+                    if (throws && task == 0) {
+                        throw std::runtime_error("task failed");
+                    }
+                });
+            }
+            try {
+                ctx.wait_all();
+            }
+            catch (const std::runtime_error &) {
+                rethrown.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (call == calls) {
+                finished.fetch_add(1);
+            }
+        });
+        threads.push_back(std::move(test));
+    }
+    check(wait_for_condition([&]() { return finished.load() == thread_count; }, std::chrono::seconds(60)), "executor calls not finished");
+    for (auto & test : threads) {
+        test->stop();
+    }
+    check(runs.load() == thread_count * calls * tasks * (nested + 1), "executor task lost or run twice");
+    check(rethrown.load() == thread_count * (calls / 8), "executor exception not rethrown by wait_all");
+
+    // fx returns without wait_all(), implicit wait finishes tasks before next call and reports their exception
+    simple_thread_error_queue errors(256);
+    std::atomic<size_t> running = 0;
+    std::atomic<size_t> implicit_calls = 0;
+    simple_thread_options options = quiet_options();
+    options.executor = &executor;
+    options.error_sink = &errors;
+    simple_thread test;
+    test.start(options, std::chrono::milliseconds(0), [&](simple_thread_context & ctx) {
+        if (implicit_calls.load() == calls) {
+            ctx.set_timeout(std::chrono::hours(1));
+            return;
+        }
+        check(running.load() == 0, "executor task of previous fx call still running");
+        implicit_calls.fetch_add(1);
+        for (size_t task = 0; task < tasks; ++task) {
+            running.fetch_add(1);
+            ctx.spawn([&, task]() {
+                std::this_thread::yield();
+                running.fetch_sub(1);
+                if (task == 0) {
+                    throw std::runtime_error("task failed");
+                }
+            });
+        }
+    });
+    check(wait_for_condition([&]() { return implicit_calls.load() == calls && running.load() == 0; }), "executor implicit calls not finished");
+    test.stop();
+    size_t reported = 0;
+    for (std::exception_ptr error; errors.pop(error); ) {
+        ++reported;
+    }
+    check(reported == std::min<size_t>(calls, 256), "executor exception of not waited task not reported");
+}
+
+/* Threads allocate blocks of all size classes, free own blocks and blocks passed from other threads */
+void stress_slab(size_t scale)
+{
+    const size_t thread_count = stress_threads();
+    const size_t iterations = 100000 * scale;
+    struct block
+    {
+        uint8_t *   m_data;
+        size_t      m_size;
+    };
+    std::vector<std::unique_ptr<simple_thread_mpsc_queue<block>>> inboxes;
+    for (size_t index = 0; index < thread_count; ++index) {
+        inboxes.push_back(std::make_unique<simple_thread_mpsc_queue<block>>());
+    }
+    std::atomic<size_t> running = thread_count;
+
+    auto verify_and_free = [](const block & item) {
+        const uint8_t pattern = static_cast<uint8_t>(item.m_size);
+        check(std::all_of(item.m_data, item.m_data + item.m_size, [&](uint8_t value) { return value == pattern; }),
+            "slab block overwritten");
+        simple_slab_deallocate(item.m_data, item.m_size);
+    };
+    std::vector<std::thread> threads;
+    for (size_t thread = 0; thread < thread_count; ++thread) {
+        threads.emplace_back([&, thread]() {
+            std::vector<block> own;
+            block item;
+            for (size_t iteration = 0; iteration < iterations; ++iteration) {
+                // sizes over 256 bytes go to global operator new
+                const size_t size = 1 + (iteration * 7 + thread * 13) % 300;
+                item.m_data = static_cast<uint8_t *>(simple_slab_allocate(size));
+                item.m_size = size;
+                check(reinterpret_cast<uintptr_t>(item.m_data) % alignof(std::max_align_t) == 0, "slab block not aligned");
+                std::memset(item.m_data, static_cast<uint8_t>(size), size);
+                if (iteration % 2 == 0) {
+                    inboxes[(thread + 1) % thread_count]->push(item);
+                }
+                else {
+                    own.push_back(item);
+                }
+                if (own.size() > 64) {
+                    for (const auto & owned : own) {
+                        verify_and_free(owned);
+                    }
+                    own.clear();
+                }
+                while (inboxes[thread]->pop(item)) {
+                    verify_and_free(item);
+                }
+            }
+            for (const auto & owned : own) {
+                verify_and_free(owned);
+            }
+            // blocks of threads which are still running
+            running.fetch_sub(1);
+            while (running.load() != 0) {
+                while (inboxes[thread]->pop(item)) {
+                    verify_and_free(item);
+                }
+                std::this_thread::yield();
+            }
+            while (inboxes[thread]->pop(item)) {
+                verify_and_free(item);
+            }
+        });
+    }
+    for (auto & thread : threads) {
+        thread.join();
+    }
+
+    // over-aligned slab object bypasses size classes (16 bytes aligned)
+    struct alignas(64) aligned_object : simple_slab_object
+    {
+        uint8_t     m_data[64];
+    };
+    std::vector<std::unique_ptr<aligned_object>> aligned;
+    for (size_t index = 0; index < 1000; ++index) {
+        aligned.emplace_back(new aligned_object());
+        check(reinterpret_cast<uintptr_t>(aligned.back().get()) % alignof(aligned_object) == 0, "over-aligned slab object not aligned");
+    }
+}
+
+/* Short lived threads record trace events (e.g. notify() of producers), rings of exited threads are reused after
+ * dump, without dumps number of rings stays at SIMPLE_THREAD_TRACE_MAX_THREADS
+ */
+void stress_trace(size_t scale)
+{
+    simple_thread_tracer & tracer = simple_thread_tracer::instance();
+    const size_t concurrent = stress_threads();
+    const size_t baseline = tracer.ring_count();
+    tracer.enable(true);
+    auto churn = [&](size_t thread_count) {
+        std::vector<std::thread> threads;
+        for (size_t thread = 0; thread < thread_count; ++thread) {
+            threads.emplace_back([&]() {
+                for (size_t event = 0; event < 100; ++event) {
+                    tracer.record(simple_trace_event::notify, simple_trace_phase::instant);
+                }
+            });
+        }
+        for (auto & thread : threads) {
+            thread.join();
+        }
+    };
+
+    for (size_t round = 0; round < 100 * scale; ++round) {
+        churn(concurrent);
+        std::ostringstream out;
+        tracer.write_chrome_trace(out);
+        check(out.str().find("\"notify\"") != std::string::npos, "trace events of reused ring missing");
+    }
+    check(tracer.ring_count() <= baseline + concurrent, "trace rings of dumped exited threads not reused");
+
+    for (size_t round = 0; round < SIMPLE_THREAD_TRACE_MAX_THREADS / concurrent + 10; ++round) {
+        churn(concurrent);
+    }
+    check(tracer.ring_count() <= SIMPLE_THREAD_TRACE_MAX_THREADS, "trace rings over SIMPLE_THREAD_TRACE_MAX_THREADS");
+    tracer.enable(false);
+    tracer.clear();
+}
+
+/* Short lived threads log to two async loggers in turn, every message is written once, rings of exited threads are
+ * released after flush
+ */
+void stress_async_logger(size_t scale)
+{
+    const size_t concurrent = stress_threads();
+    const size_t rounds = 100 * scale;
+    const size_t messages = 10;
+    std::ostringstream first_out;
+    std::ostringstream second_out;
+    {
+        simple_thread_async_logger first(first_out);
+        simple_thread_async_logger second(second_out);
+        for (size_t round = 0; round < rounds; ++round) {
+            std::vector<std::thread> threads;
+            for (size_t thread = 0; thread < concurrent; ++thread) {
+                threads.emplace_back([&]() {
+                    for (size_t message = 0; message < messages; ++message) {
+                        first.log("first");
+                        second.log("second");
+                    }
+                });
+            }
+            for (auto & thread : threads) {
+                thread.join();
+            }
+            first.flush();
+            second.flush();
+            check(first.ring_count() == 0 && second.ring_count() == 0, "async logger rings of exited threads not released");
+        }
+    }
+    auto lines = [](const std::ostringstream & out, const char * text) {
+        const std::string written = out.str();
+        size_t count = 0;
+        for (size_t position = written.find(text); position != std::string::npos; position = written.find(text, position + 1)) {
+            ++count;
+        }
+        return count;
+    };
+    check(lines(first_out, " first\n") == rounds * concurrent * messages && lines(second_out, " second\n") == rounds * concurrent * messages,
+        "async logger messages lost or written twice");
+}
+
+/* notify() / notify(source) of other threads race with start() and stop() of simple_thread, pool, I/O and queue
+ * thread, notify must never be lost, stop must never hang and blocked producers of stopped queue must be released
+ */
+void stress_notify_stop(size_t scale)
+{
+    const size_t notifiers = stress_threads() - 1;
+    const size_t restarts = 200 * scale;
+    std::atomic_bool done = false;
+
+    // simple_thread, restarted on parked OS thread and on new one
+    {
+        simple_thread test;
+        std::atomic<uint64_t> calls = 0;
+        std::atomic_bool wake = false;
+        std::vector<std::thread> threads;
+        for (size_t notifier = 0; notifier < notifiers; ++notifier) {
+            threads.emplace_back([&, notifier]() {
+                while (!done.load()) {
+                    if (notifier == 0) {
+                        test.notify(static_cast<unsigned>(calls.load() % simple_thread_wake_source_count));
+                    }
+                    else {
+                        test.notify();
+                    }
+                }
+            });
+        }
+        for (size_t restart = 0; restart < restarts; ++restart) {
+            simple_thread_options options = quiet_options();
+            options.wait = restart % 3 == 0 ? simple_thread_wait::spin_then_park : simple_thread_wait::park;
+            options.attributes.stack_size = restart % 4 == 0 ? 512 * 1024 : 0;
+            test.start(options, std::chrono::seconds(10), [&]() { return wake.load(); }, [&](simple_thread_context & ctx) {
+                wake.store(false);
+                calls.fetch_add(1);
+                check(!ctx.was_timeout(), "simple_thread timeout instead of notify");
+            });
+            const uint64_t before = calls.load();
+            wake.store(true);
+            test.notify();
+            check(wait_for_condition([&]() { return calls.load() > before; }), "simple_thread notify lost");
+            test.stop(restart % 2 == 0 ? simple_thread_stop_mode::park : simple_thread_stop_mode::join);
+        }
+        done.store(true);
+        for (auto & thread : threads) {
+            thread.join();
+        }
+    }
+
+    // pool workload, notify races with stop and re-registration
+    {
+        simple_thread_pool pool(2, std::chrono::milliseconds(1), &g_null_logger);
+        simple_pool_thread test(pool);
+        std::atomic<uint64_t> calls = 0;
+        std::atomic_bool wake = false;
+        done.store(false);
+        std::vector<std::thread> threads;
+        // simple_pool_thread::notify() must not overlap its own start() / stop(), notifiers use second workload
+        simple_pool_thread other(pool);
+        other.start(std::chrono::seconds(10), [&]() { return wake.load(); }, [&](simple_thread_context &) {});
+        for (size_t notifier = 0; notifier < notifiers; ++notifier) {
+            threads.emplace_back([&]() {
+                while (!done.load()) {
+                    other.notify();
+                }
+            });
+        }
+        for (size_t restart = 0; restart < restarts; ++restart) {
+            test.start(std::chrono::seconds(10), [&]() { return wake.load(); }, [&](simple_thread_context &) {
+                calls.fetch_add(1);
+            });
+            const uint64_t before = calls.load();
+            wake.store(true);
+            test.notify();
+            check(wait_for_condition([&]() { return calls.load() > before; }), "pool notify lost");
+            wake.store(false);
+            test.stop();
+        }
+        done.store(true);
+        for (auto & thread : threads) {
+            thread.join();
+        }
+    }
+
+#if !defined(_WIN32)
+    // I/O thread, readiness of pipe and notify() race with restart on parked OS thread
+    {
+        int fds[2] = { -1, -1 };
+        check(pipe(fds) == 0, "pipe not created");
+        simple_io_thread test;
+        test.add(fds[0]);
+        std::atomic<size_t> received = 0;
+        done.store(false);
+        std::vector<std::thread> threads;
+        for (size_t notifier = 0; notifier < notifiers; ++notifier) {
+            threads.emplace_back([&]() {
+                while (!done.load()) {
+                    test.notify();
+                }
+            });
+        }
+        for (size_t restart = 0; restart < restarts; ++restart) {
+            simple_thread_options options = quiet_options();
+            options.coalesce_window = restart % 3 == 0 ? std::chrono::microseconds(100) : std::chrono::microseconds(0);
+            test.start(options, std::chrono::seconds(10), [&](simple_thread_context & ctx) {
+                for (const simple_io_event & event : ctx.get_io_events()) {
+                    char buffer[64];
+                    const auto count = read(event.handle, buffer, sizeof(buffer));
+                    received.fetch_add(count > 0 ? static_cast<size_t>(count) : 0);
+                }
+            });
+            [[maybe_unused]] const auto res = write(fds[1], "x", 1);
+            check(wait_for_condition([&]() { return received.load() == restart + 1; }), "io readiness lost");
+            test.stop(restart % 2 == 0 ? simple_thread_stop_mode::park : simple_thread_stop_mode::join);
+        }
+        done.store(true);
+        for (auto & thread : threads) {
+            thread.join();
+        }
+        test.remove(fds[0]);
+        close(fds[0]);
+        close(fds[1]);
+    }
+#endif
+
+    // bounded queue thread, producers blocked on full queue are released by stop
+    for (size_t restart = 0; restart < restarts / 10 + 1; ++restart) {
+        simple_queue_options options;
+        options.capacity = 16;
+        options.overflow = simple_queue_overflow::block;
+        simple_queue_thread<uint64_t> test(options);
+        std::atomic_bool slow = true;
+        test.start(quiet_options(), std::chrono::seconds(10), [&](simple_thread_context &, std::vector<uint64_t> &) {
+            while (slow.load()) {
+                std::this_thread::yield();
+            }
+        });
+        std::atomic<size_t> finished = 0;
+        std::vector<std::thread> threads;
+        for (size_t producer = 0; producer < notifiers; ++producer) {
+            threads.emplace_back([&]() {
+                for (uint64_t value = 0; value < 1000 && test.post(value); ++value) {
+                }
+                finished.fetch_add(1);
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        slow.store(false);
+        test.stop();
+        for (auto & thread : threads) {
+            thread.join();
+        }
+        check(finished.load() == notifiers, "queue producer not released by stop");
+    }
+}
+
+#if defined(SIMPLE_THREAD_HAS_COROUTINES)
+/* Coroutine tasks spawned from several threads sleep and wait for notify on simple_thread and pool workload,
+ * tasks left suspended are destroyed with scheduler together with their captures
+ */
+void stress_coro(size_t scale)
+{
+    const size_t producers = stress_threads();
+    const size_t tasks = 500 * scale;
+    std::atomic<size_t> steps = 0;
+    std::atomic<size_t> notified = 0;
+    auto owner_alive = std::make_shared<int>(0);
+    {
+        simple_thread test;
+        simple_coro_scheduler scheduler([&]() { test.notify(); }, std::chrono::seconds(1), &g_null_logger);
+        test.start(quiet_options(), std::chrono::seconds(1),
+            [&]() { return scheduler.ready(); },
+            [&](simple_thread_context & ctx) { scheduler.run(ctx); });
+
+        std::vector<std::thread> threads;
+        for (size_t producer = 0; producer < producers; ++producer) {
+            threads.emplace_back([&]() {
+                for (size_t task = 0; task < tasks; ++task) {
+                    scheduler.spawn([&, owner_alive](simple_coro_context ctx) -> simple_coro_task {
+                        for (size_t step = 0; step < 3; ++step) {
+                            co_await ctx.sleep_for(std::chrono::milliseconds(1 + step));
+                            steps.fetch_add(1);
+                        }
+                        co_await ctx.notified();
+                        notified.fetch_add(1);
+                        // never resumed, destroyed with scheduler
+                        co_await ctx.notified();
+                    });
+                }
+            });
+        }
+        for (auto & thread : threads) {
+            thread.join();
+        }
+        check(wait_for_condition([&]() { return steps.load() == producers * tasks * 3; }), "coro sleep not resumed");
+        // the last task suspends in ctx.notified() right after its last step
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        scheduler.notify();
+        check(wait_for_condition([&]() { return notified.load() == producers * tasks; }), "coro notify not resumed");
+        check(owner_alive.use_count() > 1, "coro captures destroyed while suspended");
+        test.stop();
+    }
+    check(owner_alive.use_count() == 1, "coro captures not destroyed with scheduler");
+
+    // pool workload drives scheduler
+    simple_thread_pool pool(2, std::chrono::milliseconds(1), &g_null_logger);
+    simple_pool_thread test(pool);
+    simple_coro_scheduler scheduler([&]() { test.notify(); }, std::chrono::seconds(1), &g_null_logger);
+    test.start(std::chrono::seconds(1), [&]() { return scheduler.ready(); }, [&](simple_thread_context & ctx) { scheduler.run(ctx); });
+    std::atomic<size_t> done = 0;
+    for (size_t task = 0; task < tasks; ++task) {
+        scheduler.spawn([&](simple_coro_context ctx) -> simple_coro_task {
+            co_await ctx.sleep_for(std::chrono::milliseconds(2));
+            done.fetch_add(1);
+        });
+    }
+    check(wait_for_condition([&]() { return done.load() == tasks; }), "coro on pool not resumed");
+    test.stop();
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char * argv[])
+{
+    std::vector<std::string> selected;
+    size_t scale = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--scale" && i + 1 < argc) {
+            scale = std::max<size_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+        }
+        else {
+            selected.push_back(arg);
+        }
+    }
+
+    struct stress_test
+    {
+        const char *    m_name;
+        void            (*m_fx)(size_t scale);
+    };
+    const stress_test tests[] = {
+        { "mpsc_queue", stress_mpsc_queue },
+        { "ws_deque", stress_ws_deque },
+        { "queue_thread", stress_queue_thread },
+        { "pool_timer", stress_pool_timer },
+        { "pool_notify", stress_pool_notify },
+        { "fixed_rate", stress_fixed_rate },
+        { "executor", stress_executor },
+        { "trace", stress_trace },
+        { "async_logger", stress_async_logger },
+        { "slab", stress_slab },
+        { "notify_stop", stress_notify_stop },
+#if defined(SIMPLE_THREAD_HAS_COROUTINES)
+        { "coro", stress_coro },
+#endif
+    };
+
+    int failed = 0;
+    for (const auto & name : selected) {
+        if (std::none_of(std::begin(tests), std::end(tests), [&](const stress_test & test) { return name == test.m_name; })) {
+            std::cout << "Unknown test " << name << "\n";
+            ++failed;
+        }
+    }
+    for (const auto & test : tests) {
+        if (!selected.empty() && std::find(selected.begin(), selected.end(), test.m_name) == selected.end()) {
+            continue;
+        }
+        std::cout << log_time() << " " << test.m_name << "\n";
+        g_failures.store(0);
+        const auto start = stress_clock::now();
+        test.m_fx(scale);
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(stress_clock::now() - start);
+        const size_t failures = g_failures.load();
+        std::cout << log_time() << " " << test.m_name << (failures ? " FAILED (" + std::to_string(failures) + " checks)" : " OK")
+            << ", " << elapsed.count() << " ms\n";
+        failed += failures ? 1 : 0;
+    }
+    return failed;
+}
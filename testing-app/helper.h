@@ -2,15 +2,45 @@
 
 #include <iomanip>
 #include <chrono>
+#include <cstddef>
+#include <ctime>
+#include <new>
+#include <string>
 
-std::string log_time()
-{
-    std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+/* Assumed size of CPU cache line, data written by different threads are kept this far apart,
+ * GCC / Clang keep fixed 64, their std::hardware_destructive_interference_size depends on -mtune (ABI warning)
+ */
+#if defined(_MSC_VER) && defined(__cpp_lib_hardware_interference_size)
+inline constexpr size_t simple_thread_cache_line_size = std::hardware_destructive_interference_size;
+#else
+inline constexpr size_t simple_thread_cache_line_size = 64;
+#endif
+
+/* Start of cache line isolated group of members (state written by other threads than the one next to it),
+ * define SIMPLE_THREAD_COMPACT_LAYOUT to keep objects small instead (e.g. many idle threads on memory constrained system)
+ */
+#if defined(SIMPLE_THREAD_COMPACT_LAYOUT)
+#define SIMPLE_THREAD_CACHE_ALIGN
+#else
+#define SIMPLE_THREAD_CACHE_ALIGN alignas(simple_thread_cache_line_size)
+#endif
 
+/* Format time as HH:MM:SS local time */
+inline std::string format_log_time(std::time_t time)
+{
     struct tm timeinfo;
-    localtime_s(&timeinfo, &now);
+#if defined(_WIN32)
+    localtime_s(&timeinfo, &time);
+#else
+    localtime_r(&time, &timeinfo);
+#endif
 
     char buf[100] = { 0 };
     std::strftime(buf, sizeof(buf), "%T", &timeinfo);
     return buf;
 }
+
+inline std::string log_time()
+{
+    return format_log_time(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+}
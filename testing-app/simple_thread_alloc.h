@@ -0,0 +1,305 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+/* Slab allocator for small objects created and destroyed at high rate (queue nodes, executor tasks, coroutine frames),
+ * objects up to 256 bytes are taken from size class pools, every thread has its own cache of free blocks, so
+ * allocation and free are few instructions without lock. Blocks freed by other thread than allocated them
+ * (e.g. queue nodes, allocated by producers, freed by consumer) go back in batches through shared depot.
+ * How to use it:
+    {
+        // derive, same as library classes do
+        struct my_message : simple_slab_object { int id = 0; };
+        std::unique_ptr<my_message> message(new my_message());
+
+        // or as standard allocator
+        auto state = std::allocate_shared<my_state>(simple_slab_allocator<my_state>());
+    }
+ * \note memory of pools is never returned to OS, it is reused for next objects of the same size class
+ * \note define SIMPLE_THREAD_DISABLE_SLAB to use operator new / delete (it is also disabled under AddressSanitizer,
+ *   so it can find use after free)
+ */
+
+#if !defined(SIMPLE_THREAD_DISABLE_SLAB)
+#if defined(__SANITIZE_ADDRESS__)
+#define SIMPLE_THREAD_DISABLE_SLAB
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define SIMPLE_THREAD_DISABLE_SLAB
+#endif
+#endif
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Internal helper classes */
+namespace internal {
+    struct simple_slab_block
+    {
+        simple_slab_block *     m_next;
+    };
+
+    /* List of free blocks */
+    struct simple_slab_list
+    {
+        simple_slab_block *     m_head = nullptr;
+        size_t                  m_count = 0;
+    };
+
+    /* Free blocks of one size class shared by all threads, exchanged with thread caches in batches */
+    class simple_slab_depot
+    {
+    public:
+        static constexpr size_t batch_size = 32;        // blocks moved between thread cache and depot at once
+        static constexpr size_t slab_batches = 8;       // batches carved from one system allocation
+
+        explicit simple_slab_depot(size_t block_size)
+            : m_block_size(block_size)
+        {}
+
+        simple_slab_list take()
+        {
+            std::scoped_lock lck(m_mutex);
+            if (m_batches.empty()) {
+                carve_slab();
+            }
+            simple_slab_list batch = m_batches.back();
+            m_batches.pop_back();
+            return batch;
+        }
+        void give(simple_slab_list batch)
+        {
+            if (batch.m_count == 0) {
+                return;
+            }
+            std::scoped_lock lck(m_mutex);
+            m_batches.push_back(batch);
+        }
+
+    private:
+        /* Caller must hold m_mutex */
+        void carve_slab()
+        {
+            char * slab = static_cast<char *>(::operator new(m_block_size * batch_size * slab_batches));
+            for (size_t batch_index = 0; batch_index < slab_batches; ++batch_index) {
+                simple_slab_list batch;
+                for (size_t index = 0; index < batch_size; ++index) {
+                    auto block = reinterpret_cast<simple_slab_block *>(slab + (batch_index * batch_size + index) * m_block_size);
+                    block->m_next = batch.m_head;
+                    batch.m_head = block;
+                }
+                batch.m_count = batch_size;
+                m_batches.push_back(batch);
+            }
+        }
+
+    private:
+        simple_slab_depot(const simple_slab_depot &) = delete;
+        simple_slab_depot & operator=(const simple_slab_depot &) = delete;
+
+    private:
+        std::mutex                      m_mutex;        // protects: m_batches
+        std::vector<simple_slab_list>   m_batches;
+        size_t                          m_block_size;
+    };
+
+    /* Size classes, multiples of 16 bytes up to 256 */
+    inline constexpr size_t slab_granularity = 16;
+    inline constexpr size_t slab_class_count = 16;
+    inline constexpr size_t slab_max_size = slab_granularity * slab_class_count;
+
+    inline simple_slab_depot & slab_depot(size_t size_class)
+    {
+        // never destroyed, thread caches return blocks to it at thread exit, also after static destructors
+        static simple_slab_depot * const depots = []() {
+            auto storage = static_cast<simple_slab_depot *>(::operator new(sizeof(simple_slab_depot) * slab_class_count));
+            for (size_t index = 0; index < slab_class_count; ++index) {
+                ::new (static_cast<void *>(storage + index)) simple_slab_depot((index + 1) * slab_granularity);
+            }
+            return storage;
+        }();
+        return depots[size_class];
+    }
+
+    /* Free blocks of calling thread, trivially destructible, so it can be used also during thread exit */
+    struct simple_slab_cache
+    {
+        simple_slab_list        m_lists[slab_class_count];
+        bool                    m_registered = false;   // simple_slab_cache_flush is constructed
+        bool                    m_flushed = false;      // thread is ending, blocks go directly to depot
+    };
+
+    inline simple_slab_cache & slab_cache()
+    {
+        thread_local simple_slab_cache cache;
+        return cache;
+    }
+
+    /* Returns blocks of thread cache to depots at thread exit */
+    class simple_slab_cache_flush
+    {
+    public:
+        simple_slab_cache_flush() = default;
+        ~simple_slab_cache_flush()
+        {
+            simple_slab_cache & cache = slab_cache();
+            for (size_t size_class = 0; size_class < slab_class_count; ++size_class) {
+                slab_depot(size_class).give(std::exchange(cache.m_lists[size_class], simple_slab_list()));
+            }
+            cache.m_flushed = true;
+        }
+    private:
+        simple_slab_cache_flush(const simple_slab_cache_flush &) = delete;
+        simple_slab_cache_flush & operator=(const simple_slab_cache_flush &) = delete;
+    };
+
+    inline void slab_register_cache(simple_slab_cache & cache)
+    {
+        thread_local simple_slab_cache_flush flush;
+        cache.m_registered = true;
+    }
+
+    inline void * slab_allocate(size_t size_class)
+    {
+        simple_slab_cache & cache = slab_cache();
+        simple_slab_list & list = cache.m_lists[size_class];
+        if (!list.m_head) {
+            if (!cache.m_registered) {
+                slab_register_cache(cache);
+            }
+            list = slab_depot(size_class).take();
+            if (cache.m_flushed) {
+                // thread exit (destructors of thread_local objects), do not keep blocks in the cache
+                simple_slab_block * block = list.m_head;
+                list.m_head = block->m_next;
+                --list.m_count;
+                slab_depot(size_class).give(std::exchange(list, simple_slab_list()));
+                return block;
+            }
+        }
+        simple_slab_block * block = list.m_head;
+        list.m_head = block->m_next;
+        --list.m_count;
+        return block;
+    }
+
+    inline void slab_deallocate(void * ptr, size_t size_class)
+    {
+        simple_slab_cache & cache = slab_cache();
+        auto block = static_cast<simple_slab_block *>(ptr);
+        if (!cache.m_registered || cache.m_flushed) {
+            if (cache.m_flushed) {
+                slab_depot(size_class).give(simple_slab_list{ block, 1 });
+                return;
+            }
+            slab_register_cache(cache);
+        }
+        simple_slab_list & list = cache.m_lists[size_class];
+        block->m_next = list.m_head;
+        list.m_head = block;
+        if (++list.m_count >= 2 * simple_slab_depot::batch_size) {
+            // keep one batch, give one batch to threads which allocate more than they free
+            simple_slab_list batch;
+            batch.m_head = list.m_head;
+            simple_slab_block * last = list.m_head;
+            for (size_t index = 1; index < simple_slab_depot::batch_size; ++index) {
+                last = last->m_next;
+            }
+            list.m_head = last->m_next;
+            last->m_next = nullptr;
+            batch.m_count = simple_slab_depot::batch_size;
+            list.m_count -= simple_slab_depot::batch_size;
+            slab_depot(size_class).give(batch);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Allocate memory for object of given size, alignment of blocks is 16 bytes (max_align_t on common platforms) */
+inline void * simple_slab_allocate(size_t size)
+{
+#if !defined(SIMPLE_THREAD_DISABLE_SLAB)
+    if (size != 0 && size <= internal::slab_max_size) {
+        return internal::slab_allocate((size - 1) / internal::slab_granularity);
+    }
+#endif
+    return ::operator new(size);
+}
+
+/* Free memory from simple_slab_allocate, size must be the same as in allocation, any thread */
+inline void simple_slab_deallocate(void * ptr, size_t size) noexcept
+{
+    if (!ptr) {
+        return;
+    }
+#if !defined(SIMPLE_THREAD_DISABLE_SLAB)
+    if (size != 0 && size <= internal::slab_max_size) {
+        internal::slab_deallocate(ptr, (size - 1) / internal::slab_granularity);
+        return;
+    }
+#endif
+    ::operator delete(ptr, size);
+}
+
+/* Base of classes allocated by slab allocator, derived class is allocated by its own size, also when deleted by
+ * base pointer (class must have virtual destructor then)
+ * \note over-aligned derived class (alignas above 16 bytes) is allocated by global aligned operator new
+ */
+class simple_slab_object
+{
+public:
+    static void * operator new(size_t size)
+    {
+        return simple_slab_allocate(size);
+    }
+    static void operator delete(void * ptr, size_t size) noexcept
+    {
+        simple_slab_deallocate(ptr, size);
+    }
+    static void * operator new(size_t size, std::align_val_t alignment)
+    {
+        return ::operator new(size, alignment);
+    }
+    static void operator delete(void * ptr, size_t size, std::align_val_t alignment) noexcept
+    {
+        ::operator delete(ptr, size, alignment);
+    }
+};
+
+/* Standard allocator using slab allocator, e.g. for std::allocate_shared or node based containers */
+template <class T>
+class simple_slab_allocator
+{
+public:
+    using value_type = T;
+
+    static_assert(alignof(T) <= internal::slab_granularity, "simple_slab_allocator supports alignment up to 16 bytes");
+
+    simple_slab_allocator() noexcept = default;
+    template <class _Other>
+    simple_slab_allocator(const simple_slab_allocator<_Other> &) noexcept {}
+
+    T * allocate(size_t count)
+    {
+        return static_cast<T *>(simple_slab_allocate(count * sizeof(T)));
+    }
+    void deallocate(T * ptr, size_t count) noexcept
+    {
+        simple_slab_deallocate(ptr, count * sizeof(T));
+    }
+
+    template <class _Other>
+    bool operator==(const simple_slab_allocator<_Other> &) const noexcept {
+        return true;
+    }
+    template <class _Other>
+    bool operator!=(const simple_slab_allocator<_Other> &) const noexcept {
+        return false;
+    }
+};
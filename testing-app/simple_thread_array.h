@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "helper.h"
+#include "simple_thread_wrapper.h"
+
+/* Fixed size array of worker threads, every worker starts on its own cache line, so notify() of one worker does not
+ * invalidate cache lines of its neighbours (std::vector<simple_thread> packs small thread types next to each other,
+ * and it cannot be resized anyway, threads are not movable).
+ * How to use it:
+    {
+        simple_thread_array<simple_thread> workers(64);
+        for (size_t index = 0; index < workers.size(); ++index) {
+            workers[index].start(
+                std::chrono::seconds(1),
+                [&, index](simple_thread_context_intf & ctx) {
+                    process_partition(index);
+                }
+            );
+        }
+
+        // any thread
+        workers[partition_of(item)].notify();
+
+        // every worker is asked to stop first, then all are joined (also done by destructor)
+        workers.stop();
+    }
+
+    --- Workers constructed with arguments, same for every worker:
+    {
+        simple_thread_pool pool;
+        simple_thread_array<simple_pool_thread> workers(64, pool);
+    }
+ * \note with SIMPLE_THREAD_COMPACT_LAYOUT workers are not padded, see helper.h
+ */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Internal helper classes */
+namespace internal {
+    template <class _Thread, class = void>
+    struct has_request_stop : std::false_type {};
+    template <class _Thread>
+    struct has_request_stop<_Thread, std::void_t<decltype(std::declval<_Thread &>().request_stop())>> : std::true_type {};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Array of workers, each in its own cache line aligned slot
+ * \param  _Thread  simple_thread, simple_io_thread, simple_queue_thread<T>, simple_pool_thread, ...
+ */
+template <class _Thread>
+class simple_thread_array
+{
+    struct SIMPLE_THREAD_CACHE_ALIGN slot
+    {
+        template <class... _Args>
+        explicit slot(_Args &... args)
+            : m_thread(args...)
+        {}
+
+        _Thread     m_thread;
+    };
+
+    template <class _Value>
+    class basic_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::remove_const_t<_Value>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = _Value *;
+        using reference = _Value &;
+
+        basic_iterator() = default;
+        explicit basic_iterator(std::conditional_t<std::is_const_v<_Value>, const slot *, slot *> item)
+            : m_item(item)
+        {}
+
+        reference operator*() const {
+            return m_item->m_thread;
+        }
+        pointer operator->() const {
+            return &m_item->m_thread;
+        }
+        basic_iterator & operator++() {
+            ++m_item;
+            return *this;
+        }
+        basic_iterator operator++(int) {
+            basic_iterator prev = *this;
+            ++m_item;
+            return prev;
+        }
+        bool operator==(const basic_iterator & other) const {
+            return m_item == other.m_item;
+        }
+        bool operator!=(const basic_iterator & other) const {
+            return m_item != other.m_item;
+        }
+
+    private:
+        std::conditional_t<std::is_const_v<_Value>, const slot *, slot *> m_item = nullptr;
+    };
+
+public:
+    using iterator = basic_iterator<_Thread>;
+    using const_iterator = basic_iterator<const _Thread>;
+
+    /* Create workers, they are not started
+     * \param[in]  count    number of workers
+     * \param[in]  ...      (optional) constructor arguments, passed as lvalues to every worker, e.g. simple_thread_pool &
+     */
+    template <class... _Args>
+    explicit simple_thread_array(size_t count, _Args &&... args)
+        : m_slots(static_cast<slot *>(::operator new(sizeof(slot) * count, std::align_val_t(alignof(slot)))))
+    {
+        try {
+            for (; m_size < count; ++m_size) {
+                ::new (static_cast<void *>(m_slots + m_size)) slot(args...);
+            }
+        }
+        catch (...) {
+            destroy();
+            throw;
+        }
+    }
+    ~simple_thread_array()
+    {
+        stop();
+        destroy();
+    }
+
+    /* Stop all workers, request_stop() is called on every worker before the first one is joined,
+     * so workers end in parallel
+     */
+    void stop()
+    {
+        if constexpr (internal::has_request_stop<_Thread>::value) {
+            for (size_t index = 0; index < m_size; ++index) {
+                m_slots[index].m_thread.request_stop();
+            }
+        }
+        for (size_t index = 0; index < m_size; ++index) {
+            m_slots[index].m_thread.stop();
+        }
+    }
+
+    _Thread & operator[](size_t index) {
+        return m_slots[index].m_thread;
+    }
+    const _Thread & operator[](size_t index) const {
+        return m_slots[index].m_thread;
+    }
+    size_t size() const {
+        return m_size;
+    }
+
+    iterator begin() {
+        return iterator(m_slots);
+    }
+    iterator end() {
+        return iterator(m_slots + m_size);
+    }
+    const_iterator begin() const {
+        return const_iterator(m_slots);
+    }
+    const_iterator end() const {
+        return const_iterator(m_slots + m_size);
+    }
+
+private:
+    /* Destroy constructed workers in reverse order and free storage */
+    void destroy()
+    {
+        while (m_size > 0) {
+            m_slots[--m_size].~slot();
+        }
+        ::operator delete(m_slots, std::align_val_t(alignof(slot)));
+    }
+
+private:
+    simple_thread_array(const simple_thread_array &) = delete;
+    simple_thread_array & operator=(const simple_thread_array &) = delete;
+
+private:
+    slot *                      m_slots;
+    size_t                      m_size = 0;     // constructed workers
+};
@@ -0,0 +1,356 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+#if defined(_WIN32)
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#endif
+
+/* OS thread attributes of simple_thread worker, see simple_thread_options::attributes
+ * How to use it:
+    {
+        simple_thread_options options;
+        options.attributes.name = "sampler";
+        options.attributes.affinity = { 2 };                        // pin to CPU 2
+        options.attributes.policy = simple_thread_policy::fifo;     // real-time, needs privileges
+        options.attributes.priority = 50;
+        options.attributes.stack_size = 256 * 1024;
+
+        simple_thread test;
+        test.start(options, std::chrono::milliseconds(1), [&](simple_thread_context_intf & ctx) {...});
+    }
+ * \note attributes which can not be applied (missing privileges, unsupported platform) are reported by
+ *   the thread logger, thread runs without them
+ */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* OS scheduling policy */
+enum class simple_thread_policy
+{
+    normal,         // default time sharing (SCHED_OTHER), priority is Windows THREAD_PRIORITY_* value
+    fifo,           // real-time SCHED_FIFO, priority is sched_priority (1 - 99 on Linux)
+    round_robin,    // real-time SCHED_RR, priority is sched_priority
+    batch,          // SCHED_BATCH (Linux), THREAD_PRIORITY_BELOW_NORMAL on Windows
+    idle,           // SCHED_IDLE (Linux), THREAD_PRIORITY_IDLE on Windows
+};
+
+/* Worker thread attributes, default values keep OS defaults */
+struct simple_thread_attributes
+{
+    std::string             name;                       // thread name shown in debuggers (Linux limit is 15 chars)
+    std::vector<unsigned>   affinity;                   // CPUs thread may run on, empty = all (on Windows all CPUs must be in one processor group)
+    simple_thread_policy    policy = simple_thread_policy::normal;
+    int                     priority = 0;               // priority within policy, see simple_thread_policy
+    size_t                  stack_size = 0;             // bytes, 0 = OS default
+    int                     numa_node = -1;             // preferred NUMA node for thread-local allocations, -1 = none
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Internal helper classes */
+namespace internal {
+    /* OS thread with configurable stack size, same ownership semantics as std::thread */
+    class simple_native_thread
+    {
+    public:
+        simple_native_thread() = default;
+
+        /* Start thread running fx(), throws std::system_error when thread can not be created */
+        template <class _Fn>
+        simple_native_thread(size_t stack_size, _Fn && fx)
+        {
+            auto state = std::make_unique<std::decay_t<_Fn>>(std::forward<_Fn>(fx));
+            create(stack_size, &thread_proc<std::decay_t<_Fn>>, state.get());
+            state.release();    // owned by the thread now
+        }
+        simple_native_thread(simple_native_thread && other) noexcept
+            : m_handle(std::exchange(other.m_handle, native_handle_type()))
+            , m_joinable(std::exchange(other.m_joinable, false))
+        {}
+        simple_native_thread & operator=(simple_native_thread && other) noexcept
+        {
+            if (m_joinable) {
+                std::terminate();
+            }
+            m_handle = std::exchange(other.m_handle, native_handle_type());
+            m_joinable = std::exchange(other.m_joinable, false);
+            return *this;
+        }
+        ~simple_native_thread()
+        {
+            if (m_joinable) {
+                std::terminate();
+            }
+        }
+
+        bool joinable() const
+        {
+            return m_joinable;
+        }
+        void join()
+        {
+            if (!m_joinable) {
+                throw std::system_error(std::make_error_code(std::errc::invalid_argument), "join");
+            }
+#if defined(_WIN32)
+            WaitForSingleObject(m_handle, INFINITE);
+            CloseHandle(m_handle);
+#else
+            pthread_join(m_handle, nullptr);
+#endif
+            m_handle = native_handle_type();
+            m_joinable = false;
+        }
+
+    private:
+#if defined(_WIN32)
+        using native_handle_type = HANDLE;
+        using thread_proc_type = unsigned (__stdcall *)(void *);
+
+        template <class _Fn>
+        static unsigned __stdcall thread_proc(void * arg)
+        {
+            std::unique_ptr<_Fn> fx(static_cast<_Fn *>(arg));
+            (*fx)();
+            return 0;
+        }
+        void create(size_t stack_size, thread_proc_type proc, void * arg)
+        {
+            const uintptr_t handle = _beginthreadex(nullptr, static_cast<unsigned>(stack_size), proc, arg,
+                stack_size ? STACK_SIZE_PARAM_IS_A_RESERVATION : 0, nullptr);
+            if (handle == 0) {
+                throw std::system_error(errno, std::generic_category(), "_beginthreadex");
+            }
+            m_handle = reinterpret_cast<HANDLE>(handle);
+            m_joinable = true;
+        }
+#else
+        using native_handle_type = pthread_t;
+        using thread_proc_type = void * (*)(void *);
+
+        template <class _Fn>
+        static void * thread_proc(void * arg)
+        {
+            std::unique_ptr<_Fn> fx(static_cast<_Fn *>(arg));
+            (*fx)();
+            return nullptr;
+        }
+        void create(size_t stack_size, thread_proc_type proc, void * arg)
+        {
+            pthread_attr_t attr;
+            pthread_attr_init(&attr);
+            if (stack_size) {
+                const long page = sysconf(_SC_PAGESIZE);
+                stack_size = (stack_size + page - 1) / page * page;
+                pthread_attr_setstacksize(&attr, stack_size < size_t(PTHREAD_STACK_MIN) ? size_t(PTHREAD_STACK_MIN) : stack_size);
+            }
+            const int res = pthread_create(&m_handle, &attr, proc, arg);
+            pthread_attr_destroy(&attr);
+            if (res != 0) {
+                throw std::system_error(res, std::generic_category(), "pthread_create");
+            }
+            m_joinable = true;
+        }
+#endif
+
+    private:
+        simple_native_thread(const simple_native_thread &) = delete;
+        simple_native_thread & operator=(const simple_native_thread &) = delete;
+
+    private:
+        native_handle_type      m_handle = native_handle_type();
+        bool                    m_joinable = false;
+    };
+
+#if defined(__linux__)
+    /* Read CPUs of NUMA node from sysfs, cpulist format is "0-3,8-11" */
+    inline std::vector<unsigned> numa_node_cpus(int node)
+    {
+        std::vector<unsigned> cpus;
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        std::string range;
+        try {
+            while (std::getline(file, range, ',')) {
+                const size_t dash = range.find('-');
+                const unsigned first = static_cast<unsigned>(std::stoul(range.substr(0, dash)));
+                const unsigned last = dash == std::string::npos ? first : static_cast<unsigned>(std::stoul(range.substr(dash + 1)));
+                for (unsigned cpu = first; cpu <= last; ++cpu) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+        catch (const std::exception &) {
+            // empty list (node without CPUs) or unexpected format
+        }
+        return cpus;
+    }
+#endif
+
+    /* Apply attributes to calling thread
+     * \param[in]  report           function called with message for every attribute which can not be applied
+     * \param[in]  reset_defaults   thread is reused (parked), attributes left at default values are reset from what
+     *                              previous workload (or its fx) set: affinity to all CPUs, no NUMA memory policy,
+     *                              SCHED_OTHER / THREAD_PRIORITY_NORMAL, name is kept
+     */
+    template <class _Report>
+    void apply_thread_attributes(const simple_thread_attributes & attributes, _Report && report, bool reset_defaults = false)
+    {
+#if defined(_WIN32)
+        const HANDLE self = GetCurrentThread();
+        if (!attributes.name.empty()) {
+            const std::wstring name(attributes.name.begin(), attributes.name.end());
+            if (FAILED(SetThreadDescription(self, name.c_str()))) {
+                report("Failed to set thread name");
+            }
+        }
+        if (!attributes.affinity.empty() || attributes.numa_node >= 0) {
+            GROUP_AFFINITY affinity = {};
+            if (!attributes.affinity.empty()) {
+                affinity.Group = static_cast<WORD>(attributes.affinity.front() / 64);
+                for (const unsigned cpu : attributes.affinity) {
+                    if (cpu / 64 == affinity.Group) {
+                        affinity.Mask |= KAFFINITY(1) << (cpu % 64);
+                    }
+                }
+            }
+            else {
+                // allocations of a thread running on node CPUs are placed on the node (first touch)
+                USHORT numa_node = static_cast<USHORT>(attributes.numa_node);
+                if (!GetNumaNodeProcessorMaskEx(numa_node, &affinity)) {
+                    affinity.Mask = 0;
+                }
+            }
+            if (affinity.Mask == 0 || !SetThreadGroupAffinity(self, &affinity, nullptr)) {
+                report("Failed to set thread affinity");
+            }
+        }
+        else if (reset_defaults) {
+            DWORD_PTR process_mask = 0;
+            DWORD_PTR system_mask = 0;
+            if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask) || !SetThreadAffinityMask(self, process_mask)) {
+                report("Failed to reset thread affinity");
+            }
+        }
+        int priority = attributes.priority;
+        switch (attributes.policy) {
+        case simple_thread_policy::fifo:
+        case simple_thread_policy::round_robin: priority = THREAD_PRIORITY_TIME_CRITICAL; break;
+        case simple_thread_policy::batch: priority = THREAD_PRIORITY_BELOW_NORMAL; break;
+        case simple_thread_policy::idle: priority = THREAD_PRIORITY_IDLE; break;
+        default: break;
+        }
+        // THREAD_PRIORITY_NORMAL is 0
+        if ((priority != 0 || reset_defaults) && !SetThreadPriority(self, priority)) {
+            report("Failed to set thread priority");
+        }
+#else
+        const pthread_t self = pthread_self();
+        if (!attributes.name.empty()) {
+#if defined(__APPLE__)
+            const int res = pthread_setname_np(attributes.name.substr(0, 63).c_str());
+#elif defined(__linux__)
+            const int res = pthread_setname_np(self, attributes.name.substr(0, 15).c_str());
+#else
+            const int res = ENOSYS;
+#endif
+            if (res != 0) {
+                report("Failed to set thread name");
+            }
+        }
+#if defined(__linux__)
+        std::vector<unsigned> cpus = attributes.affinity;
+        if (attributes.numa_node >= 0) {
+            // prefer node memory for new pages, with no libnuma dependency (MPOL_PREFERRED = 1)
+            unsigned long node_mask[16] = {};
+            const unsigned node = static_cast<unsigned>(attributes.numa_node);
+            if (node < sizeof(node_mask) * 8) {
+                node_mask[node / (sizeof(unsigned long) * 8)] |= 1ul << (node % (sizeof(unsigned long) * 8));
+            }
+            if (node >= sizeof(node_mask) * 8 || syscall(SYS_set_mempolicy, 1, node_mask, sizeof(node_mask) * 8) != 0) {
+                report("Failed to set NUMA memory policy");
+            }
+            if (cpus.empty()) {
+                cpus = numa_node_cpus(attributes.numa_node);
+                if (cpus.empty()) {
+                    report("Failed to read CPUs of NUMA node");
+                }
+            }
+        }
+        else if (reset_defaults && syscall(SYS_set_mempolicy, 0, nullptr, 0) != 0) {
+            // MPOL_DEFAULT = 0
+            report("Failed to reset NUMA memory policy");
+        }
+        if (!cpus.empty()) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (const unsigned cpu : cpus) {
+                if (cpu < CPU_SETSIZE) {
+                    CPU_SET(cpu, &set);
+                }
+            }
+            if (pthread_setaffinity_np(self, sizeof(set), &set) != 0) {
+                report("Failed to set thread affinity");
+            }
+        }
+        else if (reset_defaults) {
+            // kernel drops CPUs which are offline or outside of cpuset
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            const long count = sysconf(_SC_NPROCESSORS_CONF);
+            for (long cpu = 0; cpu < count && cpu < CPU_SETSIZE; ++cpu) {
+                CPU_SET(static_cast<unsigned>(cpu), &set);
+            }
+            if (pthread_setaffinity_np(self, sizeof(set), &set) != 0) {
+                report("Failed to reset thread affinity");
+            }
+        }
+#else
+        if (!attributes.affinity.empty() || attributes.numa_node >= 0) {
+            report("Thread affinity is not supported on this platform");
+        }
+#endif
+        if (attributes.policy != simple_thread_policy::normal) {
+            int policy = SCHED_OTHER;
+            switch (attributes.policy) {
+            case simple_thread_policy::fifo: policy = SCHED_FIFO; break;
+            case simple_thread_policy::round_robin: policy = SCHED_RR; break;
+#if defined(__linux__)
+            case simple_thread_policy::batch: policy = SCHED_BATCH; break;
+            case simple_thread_policy::idle: policy = SCHED_IDLE; break;
+#endif
+            default: break;
+            }
+            sched_param param = {};
+            param.sched_priority = policy == SCHED_FIFO || policy == SCHED_RR ? attributes.priority : 0;
+            if (pthread_setschedparam(self, policy, &param) != 0) {
+                report("Failed to set thread scheduling policy");
+            }
+        }
+        else if (reset_defaults) {
+            const sched_param param = {};
+            if (pthread_setschedparam(self, SCHED_OTHER, &param) != 0) {
+                report("Failed to reset thread scheduling policy");
+            }
+        }
+#endif
+    }
+}
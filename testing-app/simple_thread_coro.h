@@ -0,0 +1,333 @@
+#pragma once
+
+#if defined(__has_include)
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+#define SIMPLE_THREAD_HAS_COROUTINES 1
+#endif
+#endif
+
+#if defined(SIMPLE_THREAD_HAS_COROUTINES)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "simple_thread_alloc.h"
+#include "simple_thread_wrapper.h"
+
+/* Coroutine scheduler (C++20), many sequential tasks multiplexed on one simple_thread (or simple_pool_thread),
+ * task suspends by co_await ctx.sleep_for(...) or co_await ctx.notified(), all ready tasks are resumed within
+ * one wake up of the thread.
+ * How to use it:
+    {
+        simple_thread test;
+        simple_coro_scheduler scheduler([&]() { test.notify(); });     // how to wake the thread
+        test.start(
+            std::chrono::seconds(1),
+            [&]() { return scheduler.ready(); },
+            [&](simple_thread_context_intf & ctx) { scheduler.run(ctx); }
+        );
+
+        // any thread
+        scheduler.spawn([](simple_coro_context ctx) -> simple_coro_task {
+            while (!ctx.stop_requested()) {
+                send_request();
+                co_await ctx.sleep_for(std::chrono::milliseconds(10));
+                co_await ctx.notified();        // resumed by next scheduler.notify()
+            }
+        });
+        scheduler.notify();
+    }
+ * \note scheduler must outlive the thread, not finished coroutines are destroyed with scheduler
+ */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Coroutine type of scheduler tasks, frame is owned by scheduler and destroyed when coroutine finishes */
+class simple_coro_task
+{
+public:
+    struct promise_type
+    {
+        simple_coro_task get_return_object() {
+            return simple_coro_task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept {
+            return {};      // first resumed by scheduler thread
+        }
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() {
+            internal::log_message(logger, "Exception in coroutine...");
+        }
+        /* Coroutine frames are allocated by slab allocator (frames over 256 bytes by operator new) */
+        static void * operator new(size_t size) {
+            return simple_slab_allocate(size);
+        }
+        static void operator delete(void * ptr, size_t size) noexcept {
+            simple_slab_deallocate(ptr, size);
+        }
+
+        simple_thread_logger_intf * logger = nullptr;
+        std::shared_ptr<void>       owner;      // coroutine lambda (its captures), destroyed with the frame
+    };
+
+    explicit simple_coro_task(std::coroutine_handle<promise_type> handle)
+        : m_handle(handle)
+    {}
+    simple_coro_task(simple_coro_task && other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr))
+    {}
+    ~simple_coro_task()
+    {
+        // not adopted by scheduler
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+    /* Take ownership of the frame, used by scheduler */
+    std::coroutine_handle<promise_type> release()
+    {
+        return std::exchange(m_handle, nullptr);
+    }
+
+private:
+    simple_coro_task(const simple_coro_task &) = delete;
+    simple_coro_task & operator=(const simple_coro_task &) = delete;
+
+private:
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+class simple_coro_scheduler;
+
+/* Handle passed to scheduler tasks, awaitables must be awaited only by the task which received it */
+class simple_coro_context
+{
+public:
+    struct sleep_awaiter
+    {
+        bool await_ready() const noexcept {
+            return false;
+        }
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const noexcept {}
+
+        simple_coro_scheduler *                 m_scheduler;
+        std::chrono::steady_clock::time_point   m_deadline;
+    };
+    struct notify_awaiter
+    {
+        bool await_ready() const noexcept {
+            return false;
+        }
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const noexcept {}
+
+        simple_coro_scheduler *                 m_scheduler;
+    };
+
+    explicit simple_coro_context(simple_coro_scheduler & scheduler)
+        : m_scheduler(&scheduler)
+    {}
+
+    /* Suspend task for given time, other tasks run meanwhile */
+    template <class _Rep, class _Period>
+    sleep_awaiter sleep_for(const std::chrono::duration<_Rep, _Period> & duration) const {
+        return sleep_awaiter{ m_scheduler, std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(duration) };
+    }
+    sleep_awaiter sleep_until(std::chrono::steady_clock::time_point deadline) const {
+        return sleep_awaiter{ m_scheduler, deadline };
+    }
+    /* Suspend task until next simple_coro_scheduler::notify() */
+    notify_awaiter notified() const {
+        return notify_awaiter{ m_scheduler };
+    }
+    /* Check if thread running the scheduler is stopping, as seen by the last run() */
+    bool stop_requested() const;
+
+private:
+    simple_coro_scheduler * m_scheduler;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Runs coroutine tasks, run() must be called from one thread (thread function of simple_thread or pool workload)
+ */
+class simple_coro_scheduler
+{
+public:
+    /* Create scheduler
+     * \param[in]  wake             function which wakes the thread calling run(), e.g. simple_thread::notify
+     * \param[in]  idle_timeout     timeout set to thread context when no task sleeps
+     * \param[in]  logger           (optional) logger for exceptions of tasks, nullptr means std::cout
+     */
+    explicit simple_coro_scheduler(std::function<void()> wake, std::chrono::steady_clock::duration idle_timeout = std::chrono::seconds(1),
+        simple_thread_logger_intf * logger = nullptr)
+        : m_wake(std::move(wake))
+        , m_idle_timeout(idle_timeout)
+        , m_logger(logger)
+    {}
+    ~simple_coro_scheduler()
+    {
+        // frames are destroyed without resuming, so coroutines do not run (only destructors of their locals)
+        for (auto handle : m_spawned) {
+            handle.destroy();
+        }
+        for (auto handle : m_notify_waiters) {
+            handle.destroy();
+        }
+        while (!m_timers.empty()) {
+            m_timers.top().m_handle.destroy();
+            m_timers.pop();
+        }
+    }
+
+    /* Add task, any thread, task runs on next run()
+     * \param[in]  fx   function returning simple_coro_task, with parameter 'simple_coro_context', example:
+     *   [](simple_coro_context ctx) -> simple_coro_task { co_await ctx.sleep_for(std::chrono::seconds(1)); }
+     * \note fx is copied (moved) and kept until the coroutine finishes, so the coroutine can use its captures
+     */
+    template <class _Fn>
+    void spawn(_Fn && fx)
+    {
+        auto owner = std::allocate_shared<std::decay_t<_Fn>>(simple_slab_allocator<std::decay_t<_Fn>>(), std::forward<_Fn>(fx));
+        simple_coro_task task = (*owner)(simple_coro_context(*this));
+        auto handle = task.release();
+        handle.promise().logger = m_logger;
+        handle.promise().owner = std::move(owner);
+        {
+            std::scoped_lock lck(m_spawn_mutex);
+            m_spawned.push_back(handle);
+        }
+        m_spawn_pending = true;
+        m_wake();
+    }
+
+    /* Resume tasks which wait for ctx.notified(), any thread */
+    void notify()
+    {
+        m_notify_pending = true;
+        m_wake();
+    }
+
+    /* Check if run() has something to do now (except expired timers), use it as thread predicate */
+    bool ready() const
+    {
+        return m_spawn_pending.load() || m_notify_pending.load();
+    }
+
+    /* Resume all ready tasks, call it from thread function, sets thread timeout to the nearest task deadline */
+    void run(simple_thread_context_intf & ctx)
+    {
+        m_stop_requested = ctx.stop_requested();
+        if (m_spawn_pending.exchange(false)) {
+            std::vector<std::coroutine_handle<>> spawned;
+            {
+                std::scoped_lock lck(m_spawn_mutex);
+                spawned.swap(m_spawned);
+            }
+            for (auto handle : spawned) {
+                handle.resume();
+            }
+        }
+        if (m_notify_pending.exchange(false)) {
+            // only tasks which were waiting before this run, tasks suspended now wait for next notify()
+            std::vector<std::coroutine_handle<>> waiters;
+            waiters.swap(m_notify_waiters);
+            for (auto handle : waiters) {
+                handle.resume();
+            }
+        }
+        const auto now = std::chrono::steady_clock::now();
+        while (!m_timers.empty() && m_timers.top().m_deadline <= now) {
+            auto handle = m_timers.top().m_handle;
+            m_timers.pop();
+            handle.resume();
+        }
+        if (m_timers.empty()) {
+            ctx.set_timeout(m_idle_timeout);
+        }
+        else {
+            ctx.set_timeout(std::max(m_timers.top().m_deadline - std::chrono::steady_clock::now(), std::chrono::steady_clock::duration::zero()));
+        }
+    }
+
+    /* Number of tasks waiting for timer or notify (run() thread only) */
+    size_t suspended() const
+    {
+        return m_timers.size() + m_notify_waiters.size();
+    }
+
+private:
+    friend class simple_coro_context;
+
+    struct timer
+    {
+        std::chrono::steady_clock::time_point   m_deadline;
+        uint64_t                                m_sequence;     // FIFO order of equal deadlines
+        std::coroutine_handle<>                 m_handle;
+
+        bool operator>(const timer & other) const {
+            return m_deadline != other.m_deadline ? m_deadline > other.m_deadline : m_sequence > other.m_sequence;
+        }
+    };
+
+    void add_timer(std::chrono::steady_clock::time_point deadline, std::coroutine_handle<> handle)
+    {
+        m_timers.push(timer{ deadline, m_timer_sequence++, handle });
+    }
+    void add_notify_waiter(std::coroutine_handle<> handle)
+    {
+        m_notify_waiters.push_back(handle);
+    }
+
+private:
+    simple_coro_scheduler(const simple_coro_scheduler &) = delete;
+    simple_coro_scheduler & operator=(const simple_coro_scheduler &) = delete;
+
+private:
+    std::function<void()>                       m_wake;
+    std::chrono::steady_clock::duration         m_idle_timeout;
+    simple_thread_logger_intf *                 m_logger;
+
+    std::mutex                                  m_spawn_mutex;      // protects: m_spawned
+    std::vector<std::coroutine_handle<>>        m_spawned;
+    std::atomic_bool                            m_spawn_pending = false;
+    std::atomic_bool                            m_notify_pending = false;
+
+    // run() thread only
+    std::priority_queue<timer, std::vector<timer>, std::greater<timer>> m_timers;
+    uint64_t                                    m_timer_sequence = 0;
+    std::vector<std::coroutine_handle<>>        m_notify_waiters;
+    bool                                        m_stop_requested = false;   // ctx.stop_requested() of the last run()
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline void simple_coro_context::sleep_awaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    m_scheduler->add_timer(m_deadline, handle);
+}
+
+inline void simple_coro_context::notify_awaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    m_scheduler->add_notify_waiter(handle);
+}
+
+inline bool simple_coro_context::stop_requested() const
+{
+    return m_scheduler->m_stop_requested;
+}
+
+#endif // SIMPLE_THREAD_HAS_COROUTINES
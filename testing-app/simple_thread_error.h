@@ -0,0 +1,197 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+
+/* Error sinks receive exceptions thrown by thread function, see simple_thread_options::error_sink and error_policy.
+ * Sink is called by worker without m_thread_mutex held, so it can hand the error to other thread.
+ * How to use it:
+    {
+        simple_thread_error_queue errors;       // must outlive threads which use it
+
+        simple_thread_options options;
+        options.error_sink = &errors;
+        options.error_policy = simple_thread_error_policy::backoff; // next calls of failing fx are delayed 2x, 4x, ...
+
+        simple_thread test;
+        test.start(options, std::chrono::seconds(1), [&](simple_thread_context_intf & ctx) {
+            read_device();                      // may throw
+        });
+
+        // any thread, e.g. health check
+        std::exception_ptr error;
+        while (errors.pop(error)) {
+            try {
+                std::rethrow_exception(error);
+            }
+            catch (const std::exception & e) {
+                report_failure(e.what());
+            }
+        }
+    }
+
+    --- First exception as std::future, thread ends on it:
+    {
+        simple_thread_error_future failure;
+        simple_thread_options options;
+        options.error_sink = &failure;
+        options.error_policy = simple_thread_error_policy::stop;
+
+        auto failed = failure.get_future();
+        simple_thread test;
+        test.start(options, std::chrono::seconds(1), [&](simple_thread_context_intf & ctx) {...});
+        failed.get();                           // rethrows exception of fx
+    }
+ */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Error sink interface */
+class simple_thread_error_sink_intf
+{
+public:
+    virtual ~simple_thread_error_sink_intf() {};
+    /* Called by worker thread for every exception of fx, must not block (failure storm calls it on every wake up) */
+    virtual void report(const std::exception_ptr & error) noexcept = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Bounded lock-free queue of errors (Vyukov MPMC ring), any number of workers report, any thread pops,
+ * errors over capacity are counted and dropped
+ */
+class simple_thread_error_queue : public simple_thread_error_sink_intf
+{
+public:
+    /* \param[in]  capacity    (optional) errors kept until pop(), rounded up to power of 2 */
+    explicit simple_thread_error_queue(size_t capacity = 64)
+        : m_capacity(round_up_pow2(capacity))
+        , m_slots(std::make_unique<slot[]>(m_capacity))
+    {
+        for (size_t index = 0; index < m_capacity; ++index) {
+            m_slots[index].m_sequence.store(index, std::memory_order_relaxed);
+        }
+    }
+
+    void report(const std::exception_ptr & error) noexcept override
+    {
+        size_t position = m_enqueue.load(std::memory_order_relaxed);
+        while (true) {
+            slot & item = m_slots[position & (m_capacity - 1)];
+            const size_t sequence = item.m_sequence.load(std::memory_order_acquire);
+            if (sequence == position) {
+                if (m_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    item.m_error = error;
+                    item.m_sequence.store(position + 1, std::memory_order_release);
+                    return;
+                }
+            }
+            else if (sequence < position) {
+                // full
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            else {
+                position = m_enqueue.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /* Take oldest error, any thread
+     * \return  false  when there is no error
+     */
+    bool pop(std::exception_ptr & error)
+    {
+        size_t position = m_dequeue.load(std::memory_order_relaxed);
+        while (true) {
+            slot & item = m_slots[position & (m_capacity - 1)];
+            const size_t sequence = item.m_sequence.load(std::memory_order_acquire);
+            if (sequence == position + 1) {
+                if (m_dequeue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    error = std::move(item.m_error);
+                    item.m_error = nullptr;
+                    item.m_sequence.store(position + m_capacity, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (sequence < position + 1) {
+                return false;
+            }
+            else {
+                position = m_dequeue.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /* Number of errors dropped because queue was full */
+    uint64_t dropped() const
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct slot
+    {
+        std::atomic<size_t>     m_sequence = 0;
+        std::exception_ptr      m_error;
+    };
+
+    static size_t round_up_pow2(size_t value)
+    {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+private:
+    simple_thread_error_queue(const simple_thread_error_queue &) = delete;
+    simple_thread_error_queue & operator=(const simple_thread_error_queue &) = delete;
+
+private:
+    const size_t                m_capacity;
+    std::unique_ptr<slot[]>     m_slots;
+    std::atomic<size_t>         m_enqueue = 0;
+    std::atomic<size_t>         m_dequeue = 0;
+    std::atomic<uint64_t>       m_dropped = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Keeps the first error in std::future, following errors are ignored */
+class simple_thread_error_future : public simple_thread_error_sink_intf
+{
+public:
+    simple_thread_error_future() = default;
+
+    /* Future is ready when first error is reported, call only once */
+    std::future<void> get_future()
+    {
+        return m_promise.get_future();
+    }
+
+    void report(const std::exception_ptr & error) noexcept override
+    {
+        if (m_reported.load(std::memory_order_relaxed) || m_reported.exchange(true)) {
+            return;
+        }
+        try {
+            m_promise.set_exception(error);
+        }
+        catch (...) {
+        }
+    }
+
+private:
+    simple_thread_error_future(const simple_thread_error_future &) = delete;
+    simple_thread_error_future & operator=(const simple_thread_error_future &) = delete;
+
+private:
+    std::promise<void>          m_promise;
+    std::atomic_bool            m_reported = false;
+};
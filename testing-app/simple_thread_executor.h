@@ -0,0 +1,437 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "helper.h"
+#include "simple_thread_alloc.h"
+
+/* Work-stealing executor runs short tasks spawned from thread functions (or from other tasks) in parallel,
+ * every worker owns Chase-Lev deque, idle workers steal from busy ones. Threads waiting for their tasks
+ * (ctx.wait_all()) run tasks too, they block only when remaining tasks of their group run on other workers.
+ * How to use it:
+    {
+        simple_thread_executor executor;        // hardware_concurrency workers, must outlive threads which use it
+
+        simple_thread_options options;
+        options.executor = &executor;
+
+        simple_thread test;
+        test.start(options, std::chrono::milliseconds(10), [&](simple_thread_context & ctx) {
+            for (auto & buffer : buffers) {
+                ctx.spawn([&buffer]() { parse(buffer); });
+            }
+            ctx.wait_all();                     // rethrows first exception of tasks, needed when tasks use locals of fx
+        });
+    }
+ * \note without executor ctx.spawn() runs the task immediately
+ */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Chase-Lev work-stealing deque of pointers, owner pushes and pops at the bottom, other threads steal at the top.
+ * Buffer grows when it is full, old buffers are kept until deque is destroyed (thieves can still read them).
+ */
+template <class T>
+class simple_thread_ws_deque
+{
+    static_assert(std::is_pointer_v<T>, "simple_thread_ws_deque holds pointers");
+public:
+    explicit simple_thread_ws_deque(size_t capacity = 256)
+    {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        m_buffers.push_back(std::make_unique<buffer>(size));
+        m_buffer.store(m_buffers.back().get(), std::memory_order_relaxed);
+    }
+
+    /* Add item, owner thread only */
+    void push(T item)
+    {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        const int64_t top = m_top.load(std::memory_order_acquire);
+        buffer * items = m_buffer.load(std::memory_order_relaxed);
+        if (bottom - top >= items->m_capacity) {
+            items = grow(items, bottom, top);
+        }
+        items->put(bottom, item);
+        m_bottom.store(bottom + 1, std::memory_order_release);
+    }
+
+    /* Remove newest item, owner thread only
+     * \return  nullptr  when deque is empty
+     */
+    T pop()
+    {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        buffer * items = m_buffer.load(std::memory_order_relaxed);
+        m_bottom.store(bottom, std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_seq_cst);
+        if (top > bottom) {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T item = items->get(bottom);
+        if (top == bottom) {
+            // last item, race with thieves
+            if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    /* Remove oldest item, any thread
+     * \return  nullptr  when deque is empty, or other thread took the item first
+     */
+    T steal()
+    {
+        int64_t top = m_top.load(std::memory_order_seq_cst);
+        const int64_t bottom = m_bottom.load(std::memory_order_seq_cst);
+        if (top >= bottom) {
+            return nullptr;
+        }
+        T item = m_buffer.load(std::memory_order_acquire)->get(top);
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    /* Approximate check, any thread */
+    bool empty() const
+    {
+        return m_top.load(std::memory_order_acquire) >= m_bottom.load(std::memory_order_acquire);
+    }
+
+private:
+    struct buffer
+    {
+        explicit buffer(size_t capacity)
+            : m_capacity(static_cast<int64_t>(capacity))
+            , m_items(new std::atomic<T>[capacity])
+        {}
+        void put(int64_t index, T item) {
+            m_items[index & (m_capacity - 1)].store(item, std::memory_order_relaxed);
+        }
+        T get(int64_t index) const {
+            return m_items[index & (m_capacity - 1)].load(std::memory_order_relaxed);
+        }
+
+        const int64_t                       m_capacity;
+        std::unique_ptr<std::atomic<T>[]>   m_items;
+    };
+
+    buffer * grow(buffer * items, int64_t bottom, int64_t top)
+    {
+        m_buffers.push_back(std::make_unique<buffer>(static_cast<size_t>(items->m_capacity) * 2));
+        buffer * bigger = m_buffers.back().get();
+        for (int64_t index = top; index < bottom; ++index) {
+            bigger->put(index, items->get(index));
+        }
+        m_buffer.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+private:
+    simple_thread_ws_deque(const simple_thread_ws_deque &) = delete;
+    simple_thread_ws_deque & operator=(const simple_thread_ws_deque &) = delete;
+
+private:
+    SIMPLE_THREAD_CACHE_ALIGN
+    std::atomic<int64_t>                    m_top = 0;      // thieves side
+    SIMPLE_THREAD_CACHE_ALIGN
+    std::atomic<int64_t>                    m_bottom = 0;   // owner side
+    std::atomic<buffer *>                   m_buffer = nullptr;
+    std::vector<std::unique_ptr<buffer>>    m_buffers;      // owner only, current and retired buffers
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Tasks spawned by one thread function call (or by one parent task), executor wait() waits for all of them */
+class simple_task_group
+{
+public:
+    simple_task_group() = default;
+    ~simple_task_group()
+    {
+        // the last task can still notify m_done_cv after done() returned true
+        std::scoped_lock lck(m_mutex);
+    }
+    /* Check if all spawned tasks finished */
+    bool done() const
+    {
+        return m_pending.load(std::memory_order_acquire) == 0;
+    }
+
+private:
+    friend class simple_thread_executor;
+    simple_task_group(const simple_task_group &) = delete;
+    simple_task_group & operator=(const simple_task_group &) = delete;
+
+    /* Count finished task, only the last one takes m_mutex to wake wait() */
+    void finish_task()
+    {
+        size_t pending = m_pending.load(std::memory_order_relaxed);
+        do {
+            if (pending == 1) {
+                // decremented under mutex, so waiter cannot return (and destroy group) before notify
+                std::scoped_lock lck(m_mutex);
+                m_pending.fetch_sub(1, std::memory_order_acq_rel);
+                m_done_cv.notify_all();
+                return;
+            }
+        } while (!m_pending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+    }
+
+private:
+    std::atomic<size_t>         m_pending = 0;
+    std::mutex                  m_mutex;            // protects: m_error, m_done_cv wait, the last m_pending decrement
+    std::condition_variable     m_done_cv;          // m_pending dropped to 0
+    std::exception_ptr          m_error;            // first exception thrown by a task
+};
+
+/* Internal helper classes */
+namespace internal {
+    /* Tasks are allocated by slab allocator, spawn does not call malloc */
+    class simple_executor_task : public simple_slab_object
+    {
+    public:
+        explicit simple_executor_task(simple_task_group & group)
+            : m_group(group)
+        {}
+        virtual ~simple_executor_task() {};
+        virtual void run() = 0;
+
+        simple_task_group &     m_group;
+    };
+
+    template <class _Fn>
+    class simple_executor_task_impl final : public simple_executor_task
+    {
+    public:
+        template <class _Ty>
+        simple_executor_task_impl(simple_task_group & group, _Ty && fx)
+            : simple_executor_task(group)
+            , m_fx(std::forward<_Ty>(fx))
+        {}
+        void run() override {
+            m_fx();
+        }
+    private:
+        _Fn     m_fx;
+    };
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Fixed-size set of work-stealing worker threads
+ */
+class simple_thread_executor
+{
+public:
+    /* Create executor and start its workers
+     * \param[in]  workers  number of worker threads, 0 means std::thread::hardware_concurrency()
+     */
+    explicit simple_thread_executor(size_t workers = 0)
+    {
+        if (workers == 0) {
+            workers = std::max<size_t>(1, std::thread::hardware_concurrency());
+        }
+        for (size_t index = 0; index < workers; ++index) {
+            m_deques.push_back(std::make_unique<simple_thread_ws_deque<task_ptr>>());
+        }
+        for (size_t index = 0; index < workers; ++index) {
+            m_workers.emplace_back([this, index]() { worker_proc(index); });
+        }
+    }
+    /* Stop workers, all groups must be already waited for */
+    ~simple_thread_executor()
+    {
+        {
+            std::scoped_lock lck(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        for (auto & worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    /* Run fx() on some worker, any thread, task is added to worker deque when called from a task, otherwise
+     * to shared queue
+     */
+    template <class _Fn>
+    void spawn(simple_task_group & group, _Fn && fx)
+    {
+        group.m_pending.fetch_add(1, std::memory_order_relaxed);
+        task_ptr task = new internal::simple_executor_task_impl<std::decay_t<_Fn>>(group, std::forward<_Fn>(fx));
+        if (simple_thread_ws_deque<task_ptr> * deque = current_deque()) {
+            deque->push(task);
+        }
+        else {
+            std::scoped_lock lck(m_mutex);
+            m_injected.push_back(task);
+            m_injected_count.store(m_injected.size(), std::memory_order_release);
+        }
+        wake_worker();
+    }
+
+    /* Wait until all tasks of group finished, calling thread runs tasks meanwhile
+     * \note rethrows first exception thrown by tasks of the group
+     */
+    void wait(simple_task_group & group)
+    {
+        const size_t worker = current_worker();
+        while (!group.done()) {
+            if (task_ptr task = find_task(worker)) {
+                run_task(task);
+            }
+            else {
+                // tasks of the group run on other workers and there is nothing to help with, the last one wakes us
+                std::unique_lock lck(group.m_mutex);
+                group.m_done_cv.wait(lck, [&]() { return group.done(); });
+            }
+        }
+        std::exception_ptr error;
+        {
+            std::scoped_lock lck(group.m_mutex);
+            error = std::exchange(group.m_error, nullptr);
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    size_t size() const
+    {
+        return m_workers.size();
+    }
+
+private:
+    using task_ptr = internal::simple_executor_task *;
+    static constexpr size_t no_worker = SIZE_MAX;
+
+    /* Worker index of calling thread in this executor, no_worker for other threads */
+    size_t current_worker() const
+    {
+        const auto & current = current_slot();
+        return current.first == this ? current.second : no_worker;
+    }
+    simple_thread_ws_deque<task_ptr> * current_deque() const
+    {
+        const size_t worker = current_worker();
+        return worker == no_worker ? nullptr : m_deques[worker].get();
+    }
+    static std::pair<const simple_thread_executor *, size_t> & current_slot()
+    {
+        thread_local std::pair<const simple_thread_executor *, size_t> t_current(nullptr, no_worker);
+        return t_current;
+    }
+
+    /* Own deque first, then shared queue, then steal from other workers */
+    task_ptr find_task(size_t worker)
+    {
+        if (worker != no_worker) {
+            if (task_ptr task = m_deques[worker]->pop()) {
+                return task;
+            }
+        }
+        if (m_injected_count.load(std::memory_order_acquire) > 0) {
+            std::scoped_lock lck(m_mutex);
+            if (!m_injected.empty()) {
+                task_ptr task = m_injected.front();
+                m_injected.pop_front();
+                m_injected_count.store(m_injected.size(), std::memory_order_release);
+                return task;
+            }
+        }
+        const size_t count = m_deques.size();
+        const size_t first = worker == no_worker ? m_steal_start.fetch_add(1, std::memory_order_relaxed) : worker + 1;
+        for (size_t offset = 0; offset < count; ++offset) {
+            const size_t victim = (first + offset) % count;
+            if (victim == worker) {
+                continue;
+            }
+            if (task_ptr task = m_deques[victim]->steal()) {
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    void run_task(task_ptr task)
+    {
+        simple_task_group & group = task->m_group;
+        try {
+            task->run();
+        }
+        catch (...) {
+            std::scoped_lock lck(group.m_mutex);
+            if (!group.m_error) {
+                group.m_error = std::current_exception();
+            }
+        }
+        delete task;
+        group.finish_task();
+    }
+
+    void wake_worker()
+    {
+        m_work_epoch.fetch_add(1, std::memory_order_seq_cst);
+        if (m_sleeping.load(std::memory_order_seq_cst) > 0) {
+            { std::scoped_lock lck(m_mutex); }
+            m_cv.notify_one();
+        }
+    }
+
+    void worker_proc(size_t index)
+    {
+        current_slot() = { this, index };
+        while (true)
+        {
+            const uint64_t epoch = m_work_epoch.load(std::memory_order_seq_cst);
+            if (task_ptr task = find_task(index)) {
+                run_task(task);
+                continue;
+            }
+            // nothing to do, spawn() changes epoch after task is visible
+            std::unique_lock lck(m_mutex);
+            ++m_sleeping;
+            m_cv.wait(lck, [&]() { return m_stop || m_work_epoch.load(std::memory_order_seq_cst) != epoch; });
+            --m_sleeping;
+            if (m_stop) {
+                return;
+            }
+        }
+    }
+
+private:
+    simple_thread_executor(const simple_thread_executor &) = delete;
+    simple_thread_executor & operator=(const simple_thread_executor &) = delete;
+
+private:
+    std::vector<std::unique_ptr<simple_thread_ws_deque<task_ptr>>> m_deques;     // one per worker
+    std::vector<std::thread>    m_workers;
+    std::mutex                  m_mutex;                // protects: m_injected, m_stop, m_cv wait
+    std::condition_variable     m_cv;
+    std::deque<task_ptr>        m_injected;             // tasks spawned by threads which are not workers
+    std::atomic<size_t>         m_injected_count = 0;   // m_injected size, checked without mutex
+    std::atomic<size_t>         m_sleeping = 0;
+    std::atomic<uint64_t>       m_work_epoch = 0;
+    std::atomic<size_t>         m_steal_start = 0;
+    bool                        m_stop = false;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include "simple_thread_pool.h"
+
+/* Group of simple_thread like workloads which never run concurrently, e.g. workloads sharing not thread safe
+ * state, without an outer mutex around their functions. Group has one worker thread, ready members are run
+ * by priority (higher first, FIFO within same priority), so a high-priority wake up overtakes queued
+ * low-priority members at the next function boundary.
+ * How to use it:
+    {
+        simple_thread_group group;
+        simple_group_thread control(group, 10);     // priority 10
+        simple_group_thread housekeeping(group);    // priority 0
+        control.start(
+            std::chrono::milliseconds(10),
+            [&]() -> bool {
+                return my_wakeup_value.load();
+            },
+            [&](simple_thread_context_intf & ctx) {
+                update_shared_state();              // never runs together with housekeeping
+            }
+        );
+        housekeeping.start(
+            std::chrono::seconds(1),
+            [&](simple_thread_context_intf & ctx) {
+                compact_shared_state();
+            }
+        );
+
+        my_wakeup_value.store(true);
+        control.notify();
+    }
+ * \note running member function is never interrupted, ctx.unlock() does not let other members run
+ * \note low-priority members wait while higher priority members are ready all the time
+ * \note group must outlive all its members
+ */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Serialized execution context of simple_group_thread members, simple_thread_pool with one worker */
+class simple_thread_group : public simple_thread_pool
+{
+public:
+    /* Create group and start its worker
+     * \param[in]  timer_resolution    timeouts are rounded up to this resolution, see simple_thread_pool
+     * \param[in]  logger              (optional) logger for exception messages, nullptr means std::cout, must outlive the group
+     */
+    explicit simple_thread_group(std::chrono::steady_clock::duration timer_resolution = std::chrono::milliseconds(1),
+        simple_thread_logger_intf * logger = nullptr)
+        : simple_thread_pool(1, timer_resolution, logger)
+    {}
+};
+
+/* Member of simple_thread_group, provides same interface as simple_thread
+ */
+class simple_group_thread : public simple_pool_thread
+{
+public:
+    /* Create group member
+     * \param[in]  priority     (optional) ready members with higher priority are run first
+     */
+    explicit simple_group_thread(simple_thread_group & group, int priority = 0)
+        : simple_pool_thread(group, priority)
+    {}
+};
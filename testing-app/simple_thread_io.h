@@ -0,0 +1,484 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "simple_thread_wrapper.h"
+#if defined(_WIN32)
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+/* I/O thread is simple_thread which blocks directly on readiness of registered handles (epoll on Linux,
+ * WaitForMultipleObjects on Windows, poll elsewhere), so no extra poller thread and notify() round-trip is needed.
+ * Ready handles are reported by ctx.get_io_events(), it runs the same loop as simple_thread, so notify(), pred,
+ * options, metrics and restart on parked OS thread work same as in simple_thread.
+ * How to use it:
+    {
+        simple_io_thread test;
+        test.add(socket_fd);                            // wake when socket is readable
+        test.start(
+            std::chrono::seconds(1),                    // wake after 1s even if nothing is ready
+            [&](simple_thread_context_intf & ctx) {
+                for (const simple_io_event & event : ctx.get_io_events()) {
+                    if (event.events & simple_io_read) {
+                        read_message(event.handle);
+                    }
+                }
+            }
+        );
+
+        // any thread
+        test.add(other_fd, simple_io_read | simple_io_write);
+        test.remove(socket_fd);
+    }
+ * \note handles are level triggered, handle which is still ready (not all data were read) wakes the thread again
+ * \note on Windows handle is ready when it is signalled (events, processes, waitable timers, ...), at most
+ *   MAXIMUM_WAIT_OBJECTS - 1 handles can be registered, waiting on auto-reset event resets it
+ */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Internal helper classes */
+namespace internal {
+    /* OS readiness wait with own wake up handle */
+    class simple_io_poller
+    {
+    public:
+#if defined(_WIN32)
+        simple_io_poller()
+            : m_wake_event(CreateEventW(nullptr, FALSE, FALSE, nullptr))
+        {
+            if (!m_wake_event) {
+                throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "CreateEvent");
+            }
+        }
+        ~simple_io_poller()
+        {
+            CloseHandle(m_wake_event);
+        }
+#elif defined(__linux__)
+        simple_io_poller()
+            : m_epoll(epoll_create1(EPOLL_CLOEXEC))
+        {
+            if (m_epoll < 0) {
+                throw std::system_error(errno, std::generic_category(), "epoll_create1");
+            }
+            m_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.fd = m_wake_fd;
+            if (m_wake_fd < 0 || epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake_fd, &event) != 0) {
+                const int error = errno;
+                if (m_wake_fd >= 0) {
+                    close(m_wake_fd);
+                }
+                close(m_epoll);
+                throw std::system_error(error, std::generic_category(), "eventfd");
+            }
+        }
+        ~simple_io_poller()
+        {
+            close(m_wake_fd);
+            close(m_epoll);
+        }
+#else
+        simple_io_poller()
+        {
+            if (pipe(m_wake_pipe) != 0) {
+                throw std::system_error(errno, std::generic_category(), "pipe");
+            }
+            for (const int fd : m_wake_pipe) {
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+            }
+        }
+        ~simple_io_poller()
+        {
+            close(m_wake_pipe[0]);
+            close(m_wake_pipe[1]);
+        }
+#endif
+
+        /* Register handle, throws std::system_error when handle can not be registered */
+        void add(simple_io_handle handle, uint32_t events)
+        {
+#if defined(__linux__)
+            epoll_event event = {};
+            event.events = to_epoll(events);
+            event.data.fd = handle;
+            if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, handle, &event) != 0) {
+                if (errno != EEXIST || epoll_ctl(m_epoll, EPOLL_CTL_MOD, handle, &event) != 0) {
+                    throw std::system_error(errno, std::generic_category(), "epoll_ctl");
+                }
+            }
+#else
+            {
+                std::scoped_lock lck(m_handles_mutex);
+                auto it = std::find_if(m_handles.begin(), m_handles.end(), [&](const simple_io_event & item) {
+                    return item.handle == handle;
+                });
+                if (it != m_handles.end()) {
+                    it->events = events;
+                }
+                else {
+#if defined(_WIN32)
+                    if (m_handles.size() + 1 >= MAXIMUM_WAIT_OBJECTS) {
+                        throw std::system_error(std::make_error_code(std::errc::too_many_files_open), "WaitForMultipleObjects");
+                    }
+#endif
+                    m_handles.push_back(simple_io_event{ handle, events });
+                }
+                ++m_handles_version;
+            }
+            // waiting thread must take new handle set
+            wake();
+#endif
+        }
+        /* Unregister handle */
+        void remove(simple_io_handle handle)
+        {
+#if defined(__linux__)
+            epoll_ctl(m_epoll, EPOLL_CTL_DEL, handle, nullptr);
+#else
+            {
+                std::scoped_lock lck(m_handles_mutex);
+                m_handles.erase(std::remove_if(m_handles.begin(), m_handles.end(), [&](const simple_io_event & item) {
+                    return item.handle == handle;
+                }), m_handles.end());
+                ++m_handles_version;
+            }
+            wake();
+#endif
+        }
+
+        /* Wake up wait(), any thread */
+        void wake()
+        {
+#if defined(_WIN32)
+            SetEvent(m_wake_event);
+#elif defined(__linux__)
+            const uint64_t value = 1;
+            [[maybe_unused]] const auto res = write(m_wake_fd, &value, sizeof(value));
+#else
+            const char value = 1;
+            [[maybe_unused]] const auto res = write(m_wake_pipe[1], &value, sizeof(value));
+#endif
+        }
+
+        /* Wait for ready handles, wake() or timeout, ready handles are appended to ready
+         * \return  true  when wait was ended by wake()
+         */
+        bool wait(std::chrono::steady_clock::duration timeout, std::vector<simple_io_event> & ready)
+        {
+            // round up, so thread is not woken before its deadline
+            const auto timeout_ms = std::chrono::ceil<std::chrono::milliseconds>(std::max(timeout, std::chrono::steady_clock::duration::zero())).count();
+            const int wait_ms = static_cast<int>(std::min<decltype(timeout_ms)>(timeout_ms, INT32_MAX));
+            bool woken = false;
+#if defined(_WIN32)
+            update_wait_handles();
+            const DWORD count = static_cast<DWORD>(m_wait_handles.size());
+            const DWORD res = WaitForMultipleObjects(count, m_wait_handles.data(), FALSE, static_cast<DWORD>(wait_ms));
+            if (res >= WAIT_OBJECT_0 && res < WAIT_OBJECT_0 + count) {
+                // only first signalled handle is reported, check the others without waiting
+                for (DWORD index = res - WAIT_OBJECT_0; index < count; ++index) {
+                    if (index == res - WAIT_OBJECT_0 || WaitForSingleObject(m_wait_handles[index], 0) == WAIT_OBJECT_0) {
+                        if (index == 0) {
+                            woken = true;
+                        }
+                        else {
+                            ready.push_back(simple_io_event{ m_wait_handles[index], simple_io_read });
+                        }
+                    }
+                }
+            }
+            else if (res == WAIT_FAILED) {
+                // closed handle in the set, do not spin on it
+                Sleep(static_cast<DWORD>(std::min(wait_ms, 1)));
+            }
+#elif defined(__linux__)
+            epoll_event events[max_events];
+            const int count = epoll_wait(m_epoll, events, max_events, wait_ms);
+            for (int index = 0; index < count; ++index) {
+                if (events[index].data.fd == m_wake_fd) {
+                    uint64_t value = 0;
+                    [[maybe_unused]] const auto res = read(m_wake_fd, &value, sizeof(value));
+                    woken = true;
+                }
+                else {
+                    ready.push_back(simple_io_event{ events[index].data.fd, from_epoll(events[index].events) });
+                }
+            }
+#else
+            update_wait_handles();
+            const int count = poll(m_wait_handles.data(), static_cast<nfds_t>(m_wait_handles.size()), wait_ms);
+            for (size_t index = 0; count > 0 && index < m_wait_handles.size(); ++index) {
+                const short revents = m_wait_handles[index].revents;
+                if (revents == 0) {
+                    continue;
+                }
+                if (index == 0) {
+                    char buffer[64];
+                    while (read(m_wake_pipe[0], buffer, sizeof(buffer)) > 0) {}
+                    woken = true;
+                }
+                else {
+                    uint32_t events = 0;
+                    events |= (revents & POLLIN) ? simple_io_read : 0;
+                    events |= (revents & POLLOUT) ? simple_io_write : 0;
+                    events |= (revents & (POLLERR | POLLHUP | POLLNVAL)) ? simple_io_error : 0;
+                    ready.push_back(simple_io_event{ m_wait_handles[index].fd, events });
+                }
+            }
+#endif
+            return woken;
+        }
+
+    private:
+#if defined(__linux__)
+        static constexpr int max_events = 64;
+
+        static uint32_t to_epoll(uint32_t events)
+        {
+            return ((events & simple_io_read) ? uint32_t(EPOLLIN) : 0u) | ((events & simple_io_write) ? uint32_t(EPOLLOUT) : 0u);
+        }
+        static uint32_t from_epoll(uint32_t events)
+        {
+            return ((events & (EPOLLIN | EPOLLPRI)) ? simple_io_read : 0u) | ((events & EPOLLOUT) ? simple_io_write : 0u)
+                | ((events & (EPOLLERR | EPOLLHUP)) ? simple_io_error : 0u);
+        }
+#else
+        /* Copy registered handles for the wait, wake up handle is always first */
+        void update_wait_handles()
+        {
+            std::scoped_lock lck(m_handles_mutex);
+            if (!m_wait_handles.empty() && m_wait_version == m_handles_version) {
+                return;
+            }
+            m_wait_handles.clear();
+#if defined(_WIN32)
+            m_wait_handles.push_back(m_wake_event);
+            for (const auto & item : m_handles) {
+                m_wait_handles.push_back(item.handle);
+            }
+#else
+            m_wait_handles.push_back(pollfd{ m_wake_pipe[0], POLLIN, 0 });
+            for (const auto & item : m_handles) {
+                const short events = static_cast<short>(((item.events & simple_io_read) ? POLLIN : 0) | ((item.events & simple_io_write) ? POLLOUT : 0));
+                m_wait_handles.push_back(pollfd{ item.handle, events, 0 });
+            }
+#endif
+            m_wait_version = m_handles_version;
+        }
+#endif
+
+    private:
+        simple_io_poller(const simple_io_poller &) = delete;
+        simple_io_poller & operator=(const simple_io_poller &) = delete;
+
+    private:
+#if defined(__linux__)
+        int                             m_epoll = -1;
+        int                             m_wake_fd = -1;
+#else
+        std::mutex                      m_handles_mutex;        // protects: m_handles, m_handles_version
+        std::vector<simple_io_event>    m_handles;
+        uint64_t                        m_handles_version = 0;
+        // wait() thread only
+        uint64_t                        m_wait_version = 0;
+#if defined(_WIN32)
+        HANDLE                          m_wake_event = nullptr;
+        std::vector<HANDLE>             m_wait_handles;
+#else
+        int                             m_wake_pipe[2] = { -1, -1 };
+        std::vector<pollfd>             m_wait_handles;
+#endif
+#endif
+    };
+
+    /* Wait backend of simple_io_thread, same semantic as condition_variable::wait_until with predicate,
+     * ready handles are one more wake condition, m_thread_mutex is released while worker blocks in the poller
+     */
+    class simple_io_wait
+    {
+    public:
+        static constexpr bool can_spin = false;     // spinning would not see ready handles
+
+        simple_io_wait(simple_io_poller & poller, std::atomic_bool & wake_pending)
+            : m_poller(&poller)
+            , m_wake_pending(&wake_pending)
+        {}
+
+        template <class _WakePred>
+        bool wait_until(std::unique_lock<std::mutex> & lck, std::condition_variable &,
+            std::chrono::steady_clock::time_point wait_end, _WakePred & wake_pred)
+        {
+            m_ready.clear();
+            while (true) {
+                if (!m_ready.empty() || wake_pred()) {
+                    return true;
+                }
+                const auto now = std::chrono::steady_clock::now();
+                if (now >= wait_end) {
+                    return false;
+                }
+                lck.unlock();
+                if (m_poller->wait(wait_end - now, m_ready)) {
+                    // next notify() must wake poller again, cleared before pred is evaluated
+                    m_wake_pending->store(false);
+                }
+                lck.lock();
+            }
+        }
+        void set_context(simple_thread_context & ctx)
+        {
+            ctx.set_io_events(&m_ready);
+        }
+
+    private:
+        simple_io_poller *              m_poller;
+        std::atomic_bool *              m_wake_pending;
+        std::vector<simple_io_event>    m_ready;        // handles ready after the last wait, read by fx
+    };
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Thread waiting for I/O readiness, timeout, or notify(), provides same interface as simple_thread,
+ * it runs the simple_thread loop with internal::simple_io_wait backend
+ */
+class simple_io_thread : private internal::simple_thread_waker_intf
+{
+public:
+    /* Create I/O thread, throws std::system_error when OS wait object can not be created */
+    simple_io_thread()
+        : m_thread(this)
+    {}
+
+    /* Register handle, thread wakes when the handle is ready, can be called while thread runs, any thread
+     * \param[in]  handle   file descriptor (socket, pipe, eventfd, ...), or Windows HANDLE
+     * \param[in]  events   (optional) simple_io_read and / or simple_io_write, ignored on Windows
+     * \note registering already registered handle changes its events
+     */
+    void add(simple_io_handle handle, uint32_t events = simple_io_read)
+    {
+        m_poller.add(handle, events);
+    }
+    /* Unregister handle, any thread, handle must be removed before it is closed
+     * \note when called from other thread, wake up which is already in progress can still report the handle
+     */
+    void remove(simple_io_handle handle)
+    {
+        m_poller.remove(handle);
+    }
+
+    /* Start thread and call your function when a handle is ready, or thread is awakened, see simple_thread::start */
+    template <class _Rep, class _Period, class _Fn, class... _Args>
+    std::enable_if_t<internal::is_thread_function_v<std::decay_t<_Fn> &, std::decay_t<_Args> &...>>
+    start(const std::chrono::duration<_Rep, _Period> & timeout, _Fn && fx, _Args&&... ax)
+    {
+        start(simple_thread_options(), timeout, [] { return false; }, std::forward<_Fn>(fx), std::forward<_Args>(ax)...);
+    }
+
+    /* Same as above, with function (return bool) which allow extend wake up condition, see simple_thread::start */
+    template <class _Rep, class _Period, class _Predicate, class _Fn, class... _Args>
+    std::enable_if_t<std::is_invocable_r_v<bool, _Predicate &> && internal::is_thread_function_v<std::decay_t<_Fn> &, std::decay_t<_Args> &...>>
+    start(const std::chrono::duration<_Rep, _Period> & timeout, _Predicate pred, _Fn && fx, _Args&&... ax)
+    {
+        start(simple_thread_options(), timeout, std::move(pred), std::forward<_Fn>(fx), std::forward<_Args>(ax)...);
+    }
+
+    /* Same as start(timeout, fx, ...), with additional thread options, see below */
+    template <class _Rep, class _Period, class _Fn, class... _Args>
+    std::enable_if_t<internal::is_thread_function_v<std::decay_t<_Fn> &, std::decay_t<_Args> &...>>
+    start(const simple_thread_options & options, const std::chrono::duration<_Rep, _Period> & timeout, _Fn && fx, _Args&&... ax)
+    {
+        start(options, timeout, [] { return false; }, std::forward<_Fn>(fx), std::forward<_Args>(ax)...);
+    }
+
+    /* Same as start(timeout, pred, fx, ...), with additional thread options
+     * \param[in]  options  thread parameters, same as simple_thread, wait strategy does not apply (thread always
+     *                      blocks in OS readiness wait), ready handles do not end coalesce_window
+     */
+    template <class _Rep, class _Period, class _Predicate, class _Fn, class... _Args>
+    std::enable_if_t<std::is_invocable_r_v<bool, _Predicate &> && internal::is_thread_function_v<std::decay_t<_Fn> &, std::decay_t<_Args> &...>>
+    start(const simple_thread_options & options, const std::chrono::duration<_Rep, _Period> & timeout, _Predicate pred, _Fn && fx, _Args&&... ax)
+    {
+        m_thread.start_workload(options, timeout, internal::simple_io_wait(m_poller, m_wake_pending),
+            std::move(pred), std::forward<_Fn>(fx), std::forward<_Args>(ax)...);
+    }
+
+    /* Request thread stop and return immediately (do not wait for the thread end), see simple_thread::request_stop */
+    void request_stop()
+    {
+        m_thread.request_stop();
+    }
+    /* Stop thread, waits for the thread end, see simple_thread::stop */
+    void stop(simple_thread_stop_mode mode = simple_thread_stop_mode::join)
+    {
+        m_thread.stop(mode);
+    }
+    /* Notify used with external
+     * \note when thread is running fx it is one atomic operation, only first notify() of waiting thread calls the OS
+     *   (eventfd write, SetEvent)
+     */
+    void notify()
+    {
+        m_thread.notify();
+    }
+    /* Notify by one of independent wake sources, same as simple_thread::notify(source) */
+    void notify(unsigned source)
+    {
+        m_thread.notify(source);
+    }
+    ~simple_io_thread()
+    {
+        stop();
+    }
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+    /* Runtime metrics of the thread, see simple_thread::metrics() */
+    const simple_thread_metrics & metrics() const
+    {
+        return m_thread.metrics();
+    }
+#endif
+
+private:
+    /* Called by notify() slow path of m_thread, when worker waits in the poller */
+    void wake() override
+    {
+        if (!m_wake_pending.exchange(true)) {
+            m_poller.wake();
+        }
+    }
+
+private:
+    simple_io_thread(const simple_io_thread &) = delete;
+    simple_io_thread & operator=(const simple_io_thread &) = delete;
+
+private:
+    SIMPLE_THREAD_CACHE_ALIGN
+    internal::simple_io_poller  m_poller;
+    std::atomic_bool            m_wake_pending = false;  // poller was woken and worker did not handle it yet
+    simple_thread               m_thread;               // last, it is stopped before the poller is destroyed
+};
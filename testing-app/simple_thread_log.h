@@ -0,0 +1,299 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "helper.h"
+
+/* Loggers used by simple_thread workers, see simple_thread_options::logger
+ * How to use it:
+    {
+        simple_thread_async_logger logger;      // must outlive threads which use it
+
+        simple_thread_options options;
+        options.logger = &logger;
+
+        simple_thread test;
+        test.start(options, std::chrono::seconds(1), [&](simple_thread_context_intf & ctx) {
+            throw std::bad_function_call();     // reported by logger, formatted and written by logger thread
+        });
+    }
+ */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Logger interface */
+class simple_thread_logger_intf
+{
+public:
+    virtual ~simple_thread_logger_intf() {};
+    /* Log one message, called from worker threads, message is copied, long messages can be truncated */
+    virtual void log(const char * message) = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Synchronous logger, writes to std::cout with log_time(), default when no logger is set */
+class simple_thread_console_logger : public simple_thread_logger_intf
+{
+public:
+    void log(const char * message) override
+    {
+        std::cout << log_time() << " " << message << "\n";
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Asynchronous logger, log() only copies message to per-thread lock-free ring buffer, background thread
+ * formats time (cached per second) and writes messages to output stream.
+ * \note when ring buffer of a thread is full, messages are dropped and their count is reported later
+ * \note ring of exited thread is released after its messages were written, messages logged by thread during its
+ *   thread_local destruction (after ring was released) are dropped
+ */
+class simple_thread_async_logger : public simple_thread_logger_intf
+{
+public:
+    /* Create logger and start its thread
+     * \param[in]  out              output stream, must outlive logger
+     * \param[in]  ring_capacity    messages buffered per producer thread, rounded up to power of 2
+     * \param[in]  flush_interval   how often background thread writes buffered messages
+     */
+    explicit simple_thread_async_logger(std::ostream & out = std::cout, size_t ring_capacity = 1024,
+        std::chrono::steady_clock::duration flush_interval = std::chrono::milliseconds(10))
+        : m_out(out)
+        , m_ring_capacity(round_up_pow2(ring_capacity))
+        , m_flush_interval(flush_interval)
+        , m_id(next_logger_id())
+    {
+        m_thread = std::thread([this]() { logger_proc(); });
+    }
+    ~simple_thread_async_logger()
+    {
+        {
+            std::scoped_lock lck(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+        // rings are still referenced by thread_local entries of producer threads, which drop them later
+        std::scoped_lock lck(m_rings_mutex);
+        for (auto & buffer : m_rings) {
+            buffer->m_logger_gone.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    void log(const char * message) override
+    {
+        ring * buffer = thread_ring();
+        if (!buffer) {
+            return;
+        }
+        const size_t head = buffer->m_head.load(std::memory_order_relaxed);
+        if (head - buffer->m_tail.load(std::memory_order_acquire) >= m_ring_capacity) {
+            buffer->m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        record & item = buffer->m_records[head & (m_ring_capacity - 1)];
+        item.m_time = std::chrono::system_clock::now();
+        std::strncpy(item.m_text, message, sizeof(item.m_text) - 1);
+        item.m_text[sizeof(item.m_text) - 1] = 0;
+        buffer->m_head.store(head + 1, std::memory_order_release);
+    }
+
+    /* Write all messages logged so far, waits until they are written */
+    void flush()
+    {
+        std::unique_lock lck(m_mutex);
+        const uint64_t request = ++m_flush_requested;
+        m_cv.notify_one();
+        m_flushed_cv.wait(lck, [&]() { return m_flushed >= request || m_stop; });
+    }
+
+    /* Number of rings, i.e. threads which logged and are running (or exited, but their messages were not written) */
+    size_t ring_count()
+    {
+        std::scoped_lock lck(m_rings_mutex);
+        return m_rings.size();
+    }
+
+private:
+    struct record
+    {
+        std::chrono::system_clock::time_point   m_time;
+        char                                    m_text[120];
+    };
+    /* Single producer (owner thread), single consumer (logger thread) ring */
+    struct ring
+    {
+        explicit ring(size_t capacity)
+            : m_records(capacity)
+        {}
+        std::atomic<size_t>             m_head = 0;     // written by producer
+        std::atomic<size_t>             m_tail = 0;     // written by logger thread
+        std::atomic<uint64_t>           m_dropped = 0;
+        std::atomic_bool                m_exited = false;       // producer thread ended, set after its last message
+        std::atomic_bool                m_logger_gone = false;  // logger destroyed, producer drops its entry
+        std::vector<record>             m_records;
+    };
+    /* Rings of calling thread, one per logger it logs to (usually one or two, linear search) */
+    struct thread_rings
+    {
+        explicit thread_rings(bool * exited)
+            : m_exited(exited)
+        {}
+        ~thread_rings()
+        {
+            for (auto & entry : m_entries) {
+                entry.second->m_exited.store(true, std::memory_order_release);
+            }
+            *m_exited = true;
+        }
+        std::vector<std::pair<uint64_t, std::shared_ptr<ring>>> m_entries;     // logger id, ring
+        bool *                          m_exited;
+    };
+
+    static size_t round_up_pow2(size_t value)
+    {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+    static uint64_t next_logger_id()
+    {
+        static std::atomic<uint64_t> s_id = 0;
+        return ++s_id;
+    }
+
+    /* Get ring of calling thread, registration (mutex) is done only on the first call from each thread to this logger
+     * \return  nullptr  when thread_local rings of calling thread were already destroyed
+     */
+    ring * thread_ring()
+    {
+        // trivially destructible, still valid after t_rings was destroyed
+        thread_local bool t_exited = false;
+        if (t_exited) {
+            return nullptr;
+        }
+        thread_local thread_rings t_rings(&t_exited);
+        for (const auto & entry : t_rings.m_entries) {
+            if (entry.first == m_id) {
+                return entry.second.get();
+            }
+        }
+
+        // entries of destroyed loggers are dropped, their ids are never used again
+        auto & entries = t_rings.m_entries;
+        entries.erase(std::remove_if(entries.begin(), entries.end(), [](const auto & entry) {
+            return entry.second->m_logger_gone.load(std::memory_order_relaxed);
+        }), entries.end());
+        auto buffer = std::make_shared<ring>(m_ring_capacity);
+        {
+            std::scoped_lock lck(m_rings_mutex);
+            m_rings.push_back(buffer);
+        }
+        entries.emplace_back(m_id, buffer);
+        return buffer.get();
+    }
+
+    void logger_proc()
+    {
+        std::unique_lock lck(m_mutex);
+        while (true)
+        {
+            m_cv.wait_for(lck, m_flush_interval, [&]() { return m_stop || m_flush_requested != m_flushed; });
+            const bool stop = m_stop;
+            const uint64_t request = m_flush_requested;
+            lck.unlock();
+
+            drain();
+
+            lck.lock();
+            m_flushed = request;
+            m_flushed_cv.notify_all();
+            if (stop) {
+                return;
+            }
+        }
+    }
+
+    /* Write messages of all rings, logger thread only */
+    void drain()
+    {
+        std::scoped_lock lck(m_rings_mutex);
+        bool written = false;
+        for (auto it = m_rings.begin(); it != m_rings.end(); ) {
+            const auto & buffer = *it;
+            // read before head, all messages of exited thread are then visible
+            const bool exited = buffer->m_exited.load(std::memory_order_acquire);
+            const size_t head = buffer->m_head.load(std::memory_order_acquire);
+            size_t tail = buffer->m_tail.load(std::memory_order_relaxed);
+            for (; tail != head; ++tail) {
+                const record & item = buffer->m_records[tail & (m_ring_capacity - 1)];
+                m_out << format_time(item.m_time) << " " << item.m_text << "\n";
+                written = true;
+            }
+            buffer->m_tail.store(tail, std::memory_order_release);
+
+            if (const uint64_t dropped = buffer->m_dropped.exchange(0, std::memory_order_relaxed)) {
+                m_out << format_time(std::chrono::system_clock::now()) << " " << dropped << " log messages dropped\n";
+                written = true;
+            }
+            // everything of exited thread was written
+            it = exited ? m_rings.erase(it) : it + 1;
+        }
+        if (written) {
+            m_out.flush();
+        }
+    }
+
+    /* Time formatting is cached, localtime + strftime is done once per second */
+    const std::string & format_time(std::chrono::system_clock::time_point time)
+    {
+        const std::time_t seconds = std::chrono::system_clock::to_time_t(time);
+        if (seconds != m_cached_seconds) {
+            m_cached_seconds = seconds;
+            m_cached_time = format_log_time(seconds);
+        }
+        return m_cached_time;
+    }
+
+private:
+    simple_thread_async_logger(const simple_thread_async_logger &) = delete;
+    simple_thread_async_logger & operator=(const simple_thread_async_logger &) = delete;
+
+private:
+    std::ostream &                      m_out;
+    const size_t                        m_ring_capacity;
+    const std::chrono::steady_clock::duration m_flush_interval;
+    const uint64_t                      m_id;               // identifies logger in thread_local cache
+
+    std::mutex                          m_rings_mutex;      // protects: m_rings (registration and draining)
+    std::vector<std::shared_ptr<ring>>  m_rings;            // shared with thread_local entries of producer threads
+
+    std::mutex                          m_mutex;            // protects: m_stop, m_flush_requested, m_flushed
+    std::condition_variable             m_cv;
+    std::condition_variable             m_flushed_cv;
+    bool                                m_stop = false;
+    uint64_t                            m_flush_requested = 0;
+    uint64_t                            m_flushed = 0;
+
+    // logger thread only
+    std::time_t                         m_cached_seconds = -1;
+    std::string                         m_cached_time;
+
+    std::thread                         m_thread;
+};
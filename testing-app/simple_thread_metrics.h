@@ -0,0 +1,263 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/* Runtime metrics of simple_thread, recorded only when SIMPLE_THREAD_ENABLE_METRICS is defined before
+ * including simple_thread_wrapper.h (or by compiler option), otherwise simple_thread has no metrics members
+ * and no instrumentation code.
+ * How to use it:
+    {
+        simple_thread test;
+        test.start(std::chrono::seconds(1), [&](simple_thread_context_intf & ctx) {...});
+
+        // any thread
+        const auto snapshot = test.metrics().snapshot();
+        std::cout << " fx p99 " << snapshot.fx_duration.percentile(99.0) << "ns"
+                  << " locked max " << snapshot.lock_hold.max() << "ns\n";
+    }
+ */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Internal helper functions */
+namespace internal {
+    /* Index of the highest set bit, value must not be 0 */
+    inline unsigned highest_bit(uint64_t value)
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index = 0;
+        _BitScanReverse64(&index, value);
+        return index;
+#elif defined(_MSC_VER)
+        unsigned long index = 0;
+        if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32))) {
+            return index + 32;
+        }
+        _BitScanReverse(&index, static_cast<unsigned long>(value));
+        return index;
+#else
+        return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Lock-free log-linear (HDR style) histogram of uint64_t values (nanoseconds in simple_thread_metrics),
+ * every power of two is split to 8 linear buckets, so relative error of percentiles is up to 12.5%.
+ * record() is few relaxed atomic operations and never allocates, snapshot() can be called from any thread.
+ */
+class simple_thread_histogram
+{
+public:
+    static constexpr unsigned   sub_bucket_bits = 3;
+    static constexpr unsigned   sub_bucket_count = 1u << sub_bucket_bits;
+    static constexpr unsigned   bucket_count = (64 - sub_bucket_bits + 1) * sub_bucket_count;
+
+    /* Copy of histogram counters, each counter is read atomically, but not all of them at one instant */
+    class snapshot_type
+    {
+    public:
+        uint64_t count() const {
+            return m_count;
+        }
+        uint64_t min() const {
+            return m_count ? m_min : 0;
+        }
+        uint64_t max() const {
+            return m_max;
+        }
+        double mean() const {
+            return m_count ? static_cast<double>(m_sum) / static_cast<double>(m_count) : 0.0;
+        }
+        /* Get value under which given percentage (0 - 100) of recorded values is, upper bound of the bucket */
+        uint64_t percentile(double percent) const
+        {
+            if (m_count == 0) {
+                return 0;
+            }
+            const double rank = percent <= 0.0 ? 1.0 : percent >= 100.0 ? static_cast<double>(m_count) : percent * static_cast<double>(m_count) / 100.0;
+            uint64_t seen = 0;
+            for (unsigned index = 0; index < bucket_count; ++index) {
+                seen += m_buckets[index];
+                if (seen > 0 && static_cast<double>(seen) >= rank) {
+                    return std::min(bucket_upper(index), m_max);
+                }
+            }
+            return m_max;
+        }
+        /* Raw bucket counts, see bucket_lower() / bucket_upper() */
+        const std::array<uint64_t, bucket_count> & buckets() const {
+            return m_buckets;
+        }
+
+    private:
+        friend class simple_thread_histogram;
+        std::array<uint64_t, bucket_count>  m_buckets = {};
+        uint64_t                            m_count = 0;
+        uint64_t                            m_sum = 0;
+        uint64_t                            m_min = 0;
+        uint64_t                            m_max = 0;
+    };
+
+    simple_thread_histogram() = default;
+
+    /* Add one value, any thread */
+    void record(uint64_t value)
+    {
+        m_buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(value, std::memory_order_relaxed);
+        // usually single writer (worker thread), so the loops do not spin
+        uint64_t current = m_max.load(std::memory_order_relaxed);
+        while (value > current && !m_max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+        current = m_min.load(std::memory_order_relaxed);
+        while (value < current && !m_min.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+    template <class _Rep, class _Period>
+    void record(const std::chrono::duration<_Rep, _Period> & value)
+    {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(value).count();
+        record(ns > 0 ? static_cast<uint64_t>(ns) : 0);
+    }
+
+    /* Copy counters, any thread */
+    snapshot_type snapshot() const
+    {
+        snapshot_type result;
+        for (unsigned index = 0; index < bucket_count; ++index) {
+            result.m_buckets[index] = m_buckets[index].load(std::memory_order_relaxed);
+            result.m_count += result.m_buckets[index];
+        }
+        result.m_sum = m_sum.load(std::memory_order_relaxed);
+        result.m_min = m_min.load(std::memory_order_relaxed);
+        result.m_max = m_max.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    static unsigned bucket_index(uint64_t value)
+    {
+        if (value < sub_bucket_count) {
+            return static_cast<unsigned>(value);
+        }
+        const unsigned magnitude = internal::highest_bit(value);
+        const unsigned sub_bucket = static_cast<unsigned>(value >> (magnitude - sub_bucket_bits)) & (sub_bucket_count - 1);
+        return (magnitude - sub_bucket_bits + 1) * sub_bucket_count + sub_bucket;
+    }
+    /* Lowest value stored in the bucket */
+    static uint64_t bucket_lower(unsigned index)
+    {
+        if (index < sub_bucket_count) {
+            return index;
+        }
+        const unsigned shift = index / sub_bucket_count - 1;
+        return (uint64_t(sub_bucket_count) + index % sub_bucket_count) << shift;
+    }
+    /* Highest value stored in the bucket */
+    static uint64_t bucket_upper(unsigned index)
+    {
+        return index + 1 < bucket_count ? bucket_lower(index + 1) - 1 : UINT64_MAX;
+    }
+
+private:
+    simple_thread_histogram(const simple_thread_histogram &) = delete;
+    simple_thread_histogram & operator=(const simple_thread_histogram &) = delete;
+
+private:
+    std::array<std::atomic<uint64_t>, bucket_count> m_buckets = {};
+    std::atomic<uint64_t>       m_sum = 0;
+    std::atomic<uint64_t>       m_min = UINT64_MAX;
+    std::atomic<uint64_t>       m_max = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Metrics of one simple_thread, written by its worker (notify_latency start by notify()), read by snapshot() */
+class simple_thread_metrics
+{
+public:
+    struct snapshot_type
+    {
+        uint64_t                                timeout_wakeups = 0;    // fx called with was_timeout() == true
+        uint64_t                                pred_wakeups = 0;       // fx called because of pred (notify)
+        uint64_t                                exceptions = 0;         // exceptions thrown by fx
+        simple_thread_histogram::snapshot_type  notify_latency;         // first pending notify() to fx call
+        simple_thread_histogram::snapshot_type  fx_duration;            // whole fx call
+        simple_thread_histogram::snapshot_type  lock_hold;              // fx time with m_thread_mutex held
+        simple_thread_histogram::snapshot_type  unlocked;               // fx time in ctx.unlock() / scoped_unlock() sections
+    };
+
+    simple_thread_metrics() = default;
+
+    /* Copy all metrics, any thread */
+    snapshot_type snapshot() const
+    {
+        snapshot_type result;
+        result.timeout_wakeups = m_timeout_wakeups.load(std::memory_order_relaxed);
+        result.pred_wakeups = m_pred_wakeups.load(std::memory_order_relaxed);
+        result.exceptions = m_exceptions.load(std::memory_order_relaxed);
+        result.notify_latency = m_notify_latency.snapshot();
+        result.fx_duration = m_fx_duration.snapshot();
+        result.lock_hold = m_lock_hold.snapshot();
+        result.unlocked = m_unlocked.snapshot();
+        return result;
+    }
+
+    /// Recording, used by simple_thread
+    std::atomic<uint64_t>       m_timeout_wakeups = 0;
+    std::atomic<uint64_t>       m_pred_wakeups = 0;
+    std::atomic<uint64_t>       m_exceptions = 0;
+    std::atomic<int64_t>        m_notify_time = 0;      // steady_clock ticks of the first not handled notify(), 0 = none
+    simple_thread_histogram     m_notify_latency;
+    simple_thread_histogram     m_fx_duration;
+    simple_thread_histogram     m_lock_hold;
+    simple_thread_histogram     m_unlocked;
+
+private:
+    simple_thread_metrics(const simple_thread_metrics &) = delete;
+    simple_thread_metrics & operator=(const simple_thread_metrics &) = delete;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Metrics of simple_queue_thread queue, depth and counters are recorded by producers on every post */
+class simple_queue_metrics
+{
+public:
+    struct snapshot_type
+    {
+        uint64_t                                dropped = 0;    // jobs dropped by drop_oldest / drop_newest overflow
+        uint64_t                                rejected = 0;   // jobs not posted by reject overflow or try_post()
+        uint64_t                                blocked = 0;    // posts which waited for free capacity (block overflow)
+        simple_thread_histogram::snapshot_type  depth;          // queued jobs (not taken by worker) after post
+    };
+
+    simple_queue_metrics() = default;
+
+    /* Copy all metrics, any thread */
+    snapshot_type snapshot() const
+    {
+        snapshot_type result;
+        result.dropped = m_dropped.load(std::memory_order_relaxed);
+        result.rejected = m_rejected.load(std::memory_order_relaxed);
+        result.blocked = m_blocked.load(std::memory_order_relaxed);
+        result.depth = m_depth.snapshot();
+        return result;
+    }
+
+    /// Recording, used by simple_queue_thread
+    std::atomic<uint64_t>       m_dropped = 0;
+    std::atomic<uint64_t>       m_rejected = 0;
+    std::atomic<uint64_t>       m_blocked = 0;
+    simple_thread_histogram     m_depth;
+
+private:
+    simple_queue_metrics(const simple_queue_metrics &) = delete;
+    simple_queue_metrics & operator=(const simple_queue_metrics &) = delete;
+};
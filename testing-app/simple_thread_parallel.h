@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "helper.h"
+#include "simple_thread_executor.h"
+
+/* Data parallel helpers on simple_thread_executor, index range is split to chunks which run on executor workers,
+ * calling thread runs chunks too, so it can be called from thread function (no simple_thread mutex is needed
+ * by chunks, so there is no deadlock with m_thread_mutex held by the caller), or from executor task.
+ * How to use it:
+    {
+        simple_thread_executor executor;
+        simple_thread test;
+        test.start(
+            std::chrono::seconds(1),
+            [&](simple_thread_context_intf & ctx) {
+                simple_parallel_for(executor, size_t(0), samples.size(), 1024, [&](size_t index) {
+                    samples[index] = filter(samples[index]);
+                });
+
+                const double sum = simple_parallel_reduce(executor, size_t(0), samples.size(), 4096, 0.0,
+                    [&](size_t begin, size_t end) { return std::accumulate(&samples[begin], &samples[end], 0.0); },
+                    std::plus<>());
+            }
+        );
+    }
+ * \note exception thrown by fx is rethrown to the caller after all chunks finished
+ */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* How range is split to chunks */
+enum class simple_parallel_chunking
+{
+    dynamic,        // tasks take chunks of grain size one by one (default), balances uneven chunk cost
+    static_split,   // each task gets one contiguous part of the range, lowest overhead for uniform work
+};
+
+/* Internal helper functions */
+namespace internal {
+    /* Call per chunk fx(begin, end), or per element fx(index) */
+    template <class _Index, class _Fn>
+    void parallel_invoke(_Fn & fx, _Index begin, _Index end)
+    {
+        if constexpr (std::is_invocable_v<_Fn &, _Index, _Index>) {
+            fx(begin, end);
+        }
+        else {
+            for (_Index index = begin; index != end; ++index) {
+                fx(index);
+            }
+        }
+    }
+
+    /* Run chunk_fx(begin, end) for all chunks of [first, last), task_fx(task, for_each_chunk) runs in every task
+     * \param[in]  task_fx  called once by each task with its index and function which runs all chunks of the task
+     */
+    template <class _Index, class _TaskFn>
+    void parallel_run(simple_thread_executor & executor, _Index first, _Index last, size_t grain, size_t tasks,
+        simple_parallel_chunking chunking, _TaskFn & task_fx)
+    {
+        const size_t count = static_cast<size_t>(last - first);
+        std::atomic<size_t> next_chunk = 0;
+        auto run_task = [&](size_t task) {
+            if (chunking == simple_parallel_chunking::static_split) {
+                task_fx(task, [&](auto && chunk_fx) {
+                    const size_t begin = count * task / tasks;
+                    const size_t end = count * (task + 1) / tasks;
+                    chunk_fx(static_cast<_Index>(first + begin), static_cast<_Index>(first + end));
+                });
+            }
+            else {
+                task_fx(task, [&](auto && chunk_fx) {
+                    for (size_t begin = next_chunk.fetch_add(grain, std::memory_order_relaxed); begin < count;
+                        begin = next_chunk.fetch_add(grain, std::memory_order_relaxed)) {
+                        chunk_fx(static_cast<_Index>(first + begin), static_cast<_Index>(first + std::min(count, begin + grain)));
+                    }
+                });
+            }
+        };
+
+        simple_task_group group;
+        for (size_t task = 1; task < tasks; ++task) {
+            executor.spawn(group, [&run_task, task]() { run_task(task); });
+        }
+        try {
+            run_task(0);
+        }
+        catch (...) {
+            // other tasks refer to this frame
+            try {
+                executor.wait(group);
+            }
+            catch (...) {
+            }
+            throw;
+        }
+        executor.wait(group);
+    }
+
+    /* Number of tasks for range, at most one per worker plus calling thread, each with at least one chunk */
+    inline size_t parallel_tasks(const simple_thread_executor & executor, size_t count, size_t grain)
+    {
+        const size_t chunks = (count + grain - 1) / grain;
+        return std::min(chunks, executor.size() + 1);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Call fx for all indexes of [first, last) in parallel
+ * \param[in]  executor     executor running the chunks
+ * \param[in]  first, last  integer index range
+ * \param[in]  grain        chunk size (dynamic), or minimal part size (static_split), range up to grain runs inline
+ * \param[in]  fx           per element 'void(_Index index)', or per chunk 'void(_Index begin, _Index end)'
+ * \param[in]  chunking     (optional) how range is split, see simple_parallel_chunking
+ */
+template <class _Index, class _Fn>
+void simple_parallel_for(simple_thread_executor & executor, _Index first, _Index last, size_t grain, _Fn && fx,
+    simple_parallel_chunking chunking = simple_parallel_chunking::dynamic)
+{
+    static_assert(std::is_integral_v<_Index>, "simple_parallel_for index must be integral type");
+    if (last <= first) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    const size_t count = static_cast<size_t>(last - first);
+    const size_t tasks = internal::parallel_tasks(executor, count, grain);
+    if (tasks <= 1) {
+        internal::parallel_invoke(fx, first, last);
+        return;
+    }
+    auto task_fx = [&](size_t, auto && for_each_chunk) {
+        for_each_chunk([&](_Index begin, _Index end) {
+            internal::parallel_invoke(fx, begin, end);
+        });
+    };
+    internal::parallel_run(executor, first, last, grain, tasks, chunking, task_fx);
+}
+
+/* Reduce [first, last) in parallel, every task reduces its chunks to own (cache line aligned) slot, slots are
+ * reduced by calling thread
+ * \param[in]  identity     initial value of every task, e.g. 0 for sum
+ * \param[in]  fx           value of chunk 'T(_Index begin, _Index end)'
+ * \param[in]  reduce       'T(T, T)', must be associative, with dynamic chunking also commutative
+ * \note with static_split chunking the result is deterministic (same order of reduce calls), see simple_parallel_for
+ */
+template <class T, class _Index, class _Fn, class _Reduce>
+T simple_parallel_reduce(simple_thread_executor & executor, _Index first, _Index last, size_t grain, T identity,
+    _Fn && fx, _Reduce && reduce, simple_parallel_chunking chunking = simple_parallel_chunking::dynamic)
+{
+    static_assert(std::is_integral_v<_Index>, "simple_parallel_reduce index must be integral type");
+    if (last <= first) {
+        return identity;
+    }
+    grain = std::max<size_t>(grain, 1);
+    const size_t count = static_cast<size_t>(last - first);
+    const size_t tasks = internal::parallel_tasks(executor, count, grain);
+    if (tasks <= 1) {
+        return reduce(std::move(identity), fx(first, last));
+    }
+
+    struct alignas(simple_thread_cache_line_size) slot
+    {
+        T   m_value;
+    };
+    std::vector<slot> slots(tasks, slot{ identity });
+    auto task_fx = [&](size_t task, auto && for_each_chunk) {
+        // accumulate in local variable, slot is written once
+        T value = identity;
+        for_each_chunk([&](_Index begin, _Index end) {
+            value = reduce(std::move(value), fx(begin, end));
+        });
+        slots[task].m_value = std::move(value);
+    };
+    internal::parallel_run(executor, first, last, grain, tasks, chunking, task_fx);
+
+    T result = std::move(identity);
+    for (auto & item : slots) {
+        result = reduce(std::move(result), std::move(item.m_value));
+    }
+    return result;
+}
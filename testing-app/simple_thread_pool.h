@@ -0,0 +1,420 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include "simple_thread_wrapper.h"
+#include "simple_thread_timer.h"
+
+/* Simple thread pool runs many simple_thread like workloads on a shared fixed-size set of worker threads,
+ * instead of one OS thread per workload. Timeouts of all workloads are driven by one timer thread (timing wheel).
+ * How to use it:
+    {
+        simple_thread_pool pool;            // hardware_concurrency workers
+        simple_pool_thread test(pool);      // same interface as simple_thread
+        test.start(
+            std::chrono::seconds(1),        // wake after 1s
+            [&]() -> bool {                 // (optional) extend wake conditions
+                return my_wakeup_value.load();
+            },
+            [&](simple_thread_context_intf & ctx) {
+                std::cout << " In the pool " << ctx.was_timeout() << "\n";
+            }
+        );
+
+        // trigger wakeup
+        my_wakeup_value.store(true);
+        test.notify();
+    }
+ * \note pool must outlive all simple_pool_thread objects registered to it
+ */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Internal helper classes */
+namespace internal {
+    /* One registered workload, scheduled by simple_thread_pool */
+    class simple_pool_task : public simple_thread_timer_node
+    {
+    public:
+        virtual ~simple_pool_task() {};
+        /* Evaluate user wake up condition */
+        virtual bool check_predicate() = 0;
+        /* Call user thread function */
+        virtual void invoke(simple_thread_context & ctx) = 0;
+
+        enum class task_state { waiting, queued, running, stopped };
+
+        std::mutex                              m_task_mutex;       // held while fx runs, same as simple_thread::m_thread_mutex
+        std::atomic_bool                        m_stop_requested = false;
+        std::atomic<uint64_t>                   m_wake_sources = 0; // mask of sources signalled by simple_pool_thread::notify(source)
+        int                                     m_priority = 0;     // ready queue order, higher first
+        // following members are protected by simple_thread_pool::m_pool_mutex
+        task_state                              m_state = task_state::waiting;
+        bool                                    m_timed_out = false; // task was queued by its deadline
+        bool                                    m_notified = false;  // notify arrived while task was running
+        std::chrono::steady_clock::duration     m_timeout = std::chrono::nanoseconds(0);
+        std::chrono::steady_clock::time_point   m_deadline;
+        std::chrono::steady_clock::duration     m_fx_duration = std::chrono::nanoseconds(0); // previous fx call
+    };
+
+    template <class _Predicate, class _Fn, class... _Args>
+    class simple_pool_task_impl : public simple_pool_task
+    {
+    public:
+        template <class _P, class _F, class... _A>
+        simple_pool_task_impl(_P && pred, _F && fx, _A&&... ax)
+            : m_pred(std::forward<_P>(pred))
+            , m_fx(std::forward<_F>(fx))
+            , m_args(std::forward<_A>(ax)...)
+        {}
+
+        bool check_predicate() override {
+            return m_pred();
+        }
+        void invoke(simple_thread_context & ctx) override {
+            std::apply([&](auto &... ax) { m_fx(ctx, ax...); }, m_args);
+        }
+
+    private:
+        _Predicate          m_pred;
+        _Fn                 m_fx;
+        std::tuple<_Args...> m_args;
+    };
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Fixed-size set of worker threads shared by simple_pool_thread workloads
+ */
+class simple_thread_pool
+{
+public:
+    /* Create pool and start its workers
+     * \param[in]  workers             number of worker threads, 0 means std::thread::hardware_concurrency()
+     * \param[in]  timer_resolution    timeouts are rounded up to this resolution, so close wakeups are coalesced
+     * \param[in]  logger              (optional) logger for exception messages, nullptr means std::cout, must outlive the pool
+     */
+    explicit simple_thread_pool(size_t workers = 0, std::chrono::steady_clock::duration timer_resolution = std::chrono::milliseconds(1),
+        simple_thread_logger_intf * logger = nullptr)
+        : m_wheel(timer_resolution)
+        , m_logger(logger)
+    {
+        if (workers == 0) {
+            workers = std::max(1u, std::thread::hardware_concurrency());
+        }
+        m_workers.reserve(workers);
+        for (size_t i = 0; i < workers; ++i) {
+            m_workers.emplace_back([this]() { worker_proc(); });
+        }
+        m_timer_thread = std::thread([this]() { timer_proc(); });
+    }
+    ~simple_thread_pool()
+    {
+        {
+            std::scoped_lock lck(m_pool_mutex);
+            m_pool_stop = true;
+        }
+        m_pool_cv.notify_all();
+        m_timer_cv.notify_one();
+        if (m_timer_thread.joinable()) {
+            m_timer_thread.join();
+        }
+        for (auto & worker : m_workers) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+    }
+    /* Get number of worker threads */
+    size_t size() const
+    {
+        return m_workers.size();
+    }
+
+private:
+    friend class simple_pool_thread;
+    using task_ptr = internal::simple_pool_task *;
+    using task_state = internal::simple_pool_task::task_state;
+
+    /* Register task, first wake is after its timeout */
+    void add_task(task_ptr task, std::chrono::steady_clock::duration timeout)
+    {
+        std::scoped_lock lck(m_pool_mutex);
+        task->m_timeout = timeout;
+        arm_timer(task, std::chrono::steady_clock::now() + timeout);
+    }
+
+    /* Unregister task, waits while its function is running */
+    void remove_task(task_ptr task)
+    {
+        task->m_stop_requested.store(true);
+        std::unique_lock lck(m_pool_mutex);
+        m_task_done_cv.wait(lck, [&]() {
+            return task->m_state != task_state::running;
+        });
+        if (task->m_state == task_state::queued) {
+            m_ready.erase(std::find(m_ready.begin(), m_ready.end(), task));
+        }
+        m_wheel.cancel(*task);
+        task->m_state = task_state::stopped;
+    }
+
+    void notify_task(task_ptr task)
+    {
+        {
+            std::scoped_lock lck(m_pool_mutex);
+            if (task->m_state == task_state::running) {
+                task->m_notified = true;
+                return;
+            }
+            if (task->m_state != task_state::waiting) {
+                return;
+            }
+            m_wheel.cancel(*task);
+            task->m_timed_out = false;
+            enqueue(task);
+        }
+        m_pool_cv.notify_one();
+    }
+
+    /* Caller must hold m_pool_mutex */
+    void arm_timer(task_ptr task, std::chrono::steady_clock::time_point deadline)
+    {
+        task->m_state = task_state::waiting;
+        task->m_deadline = deadline;
+        m_wheel.schedule(*task, deadline);
+        if (deadline < m_timer_wakeup) {
+            m_timer_cv.notify_one();
+        }
+    }
+    /* Caller must hold m_pool_mutex, ready queue is ordered by priority (higher first), FIFO within same priority */
+    void enqueue(task_ptr task)
+    {
+        task->m_state = task_state::queued;
+        // search from the back, so tasks with equal priority are appended without scanning the queue
+        const auto pos = std::find_if(m_ready.rbegin(), m_ready.rend(), [&](task_ptr queued) {
+            return queued->m_priority >= task->m_priority;
+        });
+        m_ready.insert(pos.base(), task);
+    }
+
+    void worker_proc()
+    {
+        std::unique_lock lck(m_pool_mutex);
+        while (true)
+        {
+            if (m_pool_stop) {
+                return;
+            }
+
+            if (m_ready.empty()) {
+                m_pool_cv.wait(lck);
+                continue;
+            }
+            task_ptr task = m_ready.front();
+            m_ready.pop_front();
+            run_task(lck, task);
+        }
+    }
+
+    /* Single timer thread, moves expired tasks to ready queue */
+    void timer_proc()
+    {
+        std::unique_lock lck(m_pool_mutex);
+        while (!m_pool_stop)
+        {
+            const auto now = std::chrono::steady_clock::now();
+            size_t expired = 0;
+            m_wheel.advance(now, [&](simple_thread_timer_node & node) {
+                auto task = static_cast<task_ptr>(&node);
+                task->m_timed_out = true;
+                enqueue(task);
+                ++expired;
+            });
+            if (expired == 1) {
+                m_pool_cv.notify_one();
+            }
+            else if (expired > 1) {
+                m_pool_cv.notify_all();
+            }
+
+            m_timer_wakeup = m_wheel.next_expiry();
+            if (m_timer_wakeup == std::chrono::steady_clock::time_point::max()) {
+                m_timer_cv.wait(lck);
+            }
+            else {
+                m_timer_cv.wait_until(lck, m_timer_wakeup);
+            }
+        }
+    }
+
+    /* Evaluate and run one task, called with m_pool_mutex held, returns with it held */
+    void run_task(std::unique_lock<std::mutex> & pool_lck, task_ptr task)
+    {
+        task->m_state = task_state::running;
+        task->m_notified = false;
+        const bool timed_out = task->m_timed_out;
+        auto thread_timeout = task->m_timeout;
+        const auto scheduled_time = task->m_deadline;
+        auto fx_duration = task->m_fx_duration;
+        auto fx_end = std::chrono::steady_clock::time_point();
+        pool_lck.unlock();
+
+        bool executed = false;
+        bool run_again = false;
+        {
+            std::unique_lock lck(task->m_task_mutex);
+            // same semantic as condition_variable::wait_for with predicate
+            const bool wait_res = task->m_wake_sources.load() != 0 || task->check_predicate();
+            if (wait_res || timed_out) {
+                executed = true;
+                internal::simple_thread_context ctx(lck, &task->m_stop_requested);
+                ctx.set_was_timeout(!wait_res);
+                ctx.set_timeout(thread_timeout);
+                ctx.set_wake_sources(task->m_wake_sources.exchange(0));
+                const auto fx_start = std::chrono::steady_clock::now();
+                ctx.set_timing(scheduled_time, fx_start, fx_duration);
+
+                try {
+                    task->invoke(ctx);
+                }
+                catch (...) {
+                    internal::log_message(m_logger, "Exception in pool thread procedure...");
+                }
+                fx_end = std::chrono::steady_clock::now();
+                fx_duration = fx_end - fx_start;
+                thread_timeout = ctx.get_new_timeout();
+
+                // wait_for in simple_thread re-checks predicate before it blocks
+                run_again = task->m_wake_sources.load() != 0 || task->check_predicate();
+            }
+        }
+
+        pool_lck.lock();
+        task->m_timeout = thread_timeout;
+        task->m_fx_duration = fx_duration;
+        if (executed) {
+            // the only place where deadline moves, so wheel never gets deadline from before the last fx call
+            task->m_deadline = fx_end + thread_timeout;
+        }
+        if (run_again || task->m_notified) {
+            task->m_timed_out = false;
+            enqueue(task);
+            m_pool_cv.notify_one();
+        }
+        else {
+            // spurious wake up keeps deadline of the last fx call
+            arm_timer(task, task->m_deadline);
+        }
+        m_task_done_cv.notify_all();
+    }
+
+private:
+    std::mutex                  m_pool_mutex;       // protects: m_pool_stop, m_ready, m_wheel, m_timer_wakeup and tasks scheduling state
+    std::condition_variable     m_pool_cv;
+    std::condition_variable     m_timer_cv;
+    std::condition_variable     m_task_done_cv;
+    bool                        m_pool_stop = false;
+    std::deque<task_ptr>        m_ready;
+    simple_thread_timer_wheel   m_wheel;
+    std::chrono::steady_clock::time_point m_timer_wakeup = std::chrono::steady_clock::time_point::max();
+    std::thread                 m_timer_thread;
+    std::vector<std::thread>    m_workers;
+    simple_thread_logger_intf * m_logger;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Workload running on simple_thread_pool, provides same interface as simple_thread
+ */
+class simple_pool_thread
+{
+public:
+    /* Create workload of the pool
+     * \param[in]  priority     (optional) ready workloads with higher priority are run first, equal ones in FIFO order
+     */
+    explicit simple_pool_thread(simple_thread_pool & pool, int priority = 0)
+        : m_pool(pool)
+        , m_priority(priority)
+    {}
+
+    /* Register your function to the pool, it is called when the workload is awakened.
+     * \param[in]  timeout  define timeout when workload should awake
+     * \param[in]  fx       function or lambda which will be called when workload is awakened
+     * \param[in]  ...      (optional) additional variadic arguments, which will be passed to fx function
+     * \note fx function has first parameter 'simple_thread_context_intf & ', example:
+     *   [&](simple_thread_context_intf & ctx) {...}
+     *   or 'simple_thread_context & ' to avoid virtual calls, example:
+     *   [&](simple_thread_context & ctx) {...}
+     */
+    template <class _Rep, class _Period, class _Fn, class... _Args>
+    std::enable_if_t<internal::is_thread_function_v<std::decay_t<_Fn> &, std::decay_t<_Args> &...>>
+    start(const std::chrono::duration<_Rep, _Period> & timeout, _Fn && fx, _Args&&... ax)
+    {
+        start(timeout, [] { return false; }, std::forward<_Fn>(fx), std::forward<_Args>(ax)...);
+    }
+
+    /* Register your function to the pool, it is called when the workload is awakened.
+     * \param[in]  timeout  define timeout when workload should awake
+     * \param[in]  pred     function (return bool) which allow extend wake up condition
+     * \param[in]  fx       function or lambda which will be called when workload is awakened
+     * \param[in]  ...      (optional) additional variadic arguments, which will be passed to fx function
+     * \note fx, pred and arguments are copied (or moved) into the pool task and passed to fx as lvalues
+     */
+    template <class _Rep, class _Period, class _Predicate, class _Fn, class... _Args>
+    std::enable_if_t<std::is_invocable_r_v<bool, _Predicate &> && internal::is_thread_function_v<std::decay_t<_Fn> &, std::decay_t<_Args> &...>>
+    start(const std::chrono::duration<_Rep, _Period> & timeout, _Predicate pred, _Fn && fx, _Args&&... ax)
+    {
+        stop();
+        using task_type = internal::simple_pool_task_impl<_Predicate, std::decay_t<_Fn>, std::decay_t<_Args>...>;
+        m_task = std::make_unique<task_type>(std::move(pred), std::forward<_Fn>(fx), std::forward<_Args>(ax)...);
+        m_task->m_priority = m_priority;
+        m_pool.add_task(m_task.get(), std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout));
+    }
+
+    /* Unregister workload from the pool, waits while workload function is running */
+    void stop()
+    {
+        if (m_task) {
+            m_pool.remove_task(m_task.get());
+            m_task.reset();
+        }
+    }
+    /* Notify used with external */
+    void notify()
+    {
+        if (m_task) {
+            m_pool.notify_task(m_task.get());
+        }
+    }
+    /* Notify by one of independent wake sources, same as simple_thread::notify(source) */
+    void notify(unsigned source)
+    {
+        if (m_task && source < simple_thread_wake_source_count) {
+            m_task->m_wake_sources.fetch_or(uint64_t(1) << source);
+            m_pool.notify_task(m_task.get());
+        }
+    }
+    ~simple_pool_thread()
+    {
+        stop();
+    }
+
+private:
+    simple_pool_thread(const simple_pool_thread &) = delete;
+    simple_pool_thread & operator=(const simple_pool_thread &) = delete;
+
+private:
+    simple_thread_pool &                            m_pool;
+    int                                             m_priority;
+    std::unique_ptr<internal::simple_pool_task>     m_task;
+};
@@ -0,0 +1,507 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <vector>
+#include "simple_thread_alloc.h"
+#include "simple_thread_wrapper.h"
+
+/* Simple queue thread is simple_thread which consumes posted jobs, producers do not share any mutex,
+ * jobs are passed through lock-free multi-producer single-consumer queue.
+ * How to use it:
+    {
+        simple_queue_thread<std::string> test;
+        test.start(
+            std::chrono::seconds(1),        // wake after 1s even if nothing was posted
+            [&](simple_thread_context_intf & ctx, std::vector<std::string> & batch) {
+                // all jobs posted since last wake up
+                for (auto & job : batch) {
+                    std::cout << " Job " << job << "\n";
+                }
+            }
+        );
+
+        // any thread
+        test.post("abc");
+        std::vector<std::string> jobs = { "d", "e", "f" };
+        test.post_batch(jobs.begin(), jobs.end());
+    }
+
+    --- Bounded queue, producers are blocked when worker does not keep up:
+    {
+        simple_queue_options options;
+        options.capacity = 10000;
+        options.overflow = simple_queue_overflow::block;        // or drop_oldest, drop_newest, reject
+        options.high_watermark = 8000;
+        options.low_watermark = 1000;
+        options.on_watermark = [&](bool high, size_t depth) {   // high: depth reached 8000, !high: fell to 1000
+            set_upstream_paused(high);
+        };
+
+        simple_queue_thread<request> test(options);
+        test.start(std::chrono::seconds(1), [&](simple_thread_context_intf & ctx, std::vector<request> & batch) {...});
+
+        // any thread, never blocks, false when queue is full
+        if (!test.try_post(make_request())) {
+            reply_busy();
+        }
+    }
+ */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Unbounded lock-free multi-producer single-consumer queue (Vyukov), push is one atomic exchange,
+ * push_batch links whole batch by one atomic exchange.
+ * \note pop(), pop_all(), discard() and empty() must be called only from one (consumer) thread,
+ *   or by several threads serialized by mutex
+ */
+template <class T>
+class simple_thread_mpsc_queue
+{
+public:
+    simple_thread_mpsc_queue()
+        : m_head(new node())
+        , m_tail(m_head.load(std::memory_order_relaxed))
+    {}
+    ~simple_thread_mpsc_queue()
+    {
+        while (m_tail) {
+            node * next = m_tail->m_next.load(std::memory_order_relaxed);
+            delete m_tail;
+            m_tail = next;
+        }
+    }
+
+    /* Add item, any thread */
+    template <class _Ty>
+    void push(_Ty && value)
+    {
+        node * item = new node(std::forward<_Ty>(value));
+        link(item, item);
+    }
+
+    /* Add items [first, last), any thread, items of one batch stay together */
+    template <class _It>
+    void push_batch(_It first, _It last)
+    {
+        if (first == last) {
+            return;
+        }
+        node * batch_first = new node(*first);
+        node * batch_last = batch_first;
+        for (++first; first != last; ++first) {
+            node * item = new node(*first);
+            batch_last->m_next.store(item, std::memory_order_relaxed);
+            batch_last = item;
+        }
+        link(batch_first, batch_last);
+    }
+
+    /* Remove oldest item, consumer thread only
+     * \return  false  when queue is empty
+     */
+    bool pop(T & value)
+    {
+        node * next = m_tail->m_next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        value = std::move(*next->m_value);
+        next->m_value.reset();      // next becomes new stub
+        delete m_tail;
+        m_tail = next;
+        return true;
+    }
+
+    /* Move all available items to the end of 'out', consumer thread only
+     * \return  number of moved items
+     */
+    size_t pop_all(std::vector<T> & out)
+    {
+        size_t count = 0;
+        for (node * next = m_tail->m_next.load(std::memory_order_acquire); next; next = m_tail->m_next.load(std::memory_order_acquire)) {
+            out.push_back(std::move(*next->m_value));
+            next->m_value.reset();
+            delete m_tail;
+            m_tail = next;
+            ++count;
+        }
+        return count;
+    }
+
+    /* Remove and destroy oldest item, consumer thread only
+     * \return  false  when queue is empty
+     */
+    bool discard()
+    {
+        node * next = m_tail->m_next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        next->m_value.reset();
+        delete m_tail;
+        m_tail = next;
+        return true;
+    }
+
+    /* Check if there is nothing to pop, consumer thread only */
+    bool empty() const
+    {
+        return m_tail->m_next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    struct node : simple_slab_object
+    {
+        node() = default;
+        template <class _Ty>
+        explicit node(_Ty && value)
+            : m_value(std::forward<_Ty>(value))
+        {}
+
+        std::atomic<node *>     m_next = nullptr;
+        std::optional<T>        m_value;
+    };
+
+    void link(node * first, node * last)
+    {
+        node * prev = m_head.exchange(last, std::memory_order_acq_rel);
+        prev->m_next.store(first, std::memory_order_release);
+    }
+
+private:
+    simple_thread_mpsc_queue(const simple_thread_mpsc_queue &) = delete;
+    simple_thread_mpsc_queue & operator=(const simple_thread_mpsc_queue &) = delete;
+
+private:
+    SIMPLE_THREAD_CACHE_ALIGN
+    std::atomic<node *>         m_head;     // producers side, last pushed node
+    SIMPLE_THREAD_CACHE_ALIGN
+    node *                      m_tail;     // consumer side, stub node
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Internal helper functions */
+namespace internal {
+    template <class _It>
+    inline constexpr bool is_forward_iterator_v = std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<_It>::iterator_category>;
+}
+
+/* What post() does when bounded queue is full */
+enum class simple_queue_overflow
+{
+    block,          // producer waits until worker takes jobs (default)
+    drop_oldest,    // job is queued, oldest queued jobs are dropped
+    drop_newest,    // posted job is dropped
+    reject,         // posted job is not queued, post() returns false (same as try_post())
+};
+
+/* Capacity and flow control of simple_queue_thread */
+struct simple_queue_options
+{
+    size_t                  capacity = 0;           // max queued jobs, 0 = unbounded
+    simple_queue_overflow   overflow = simple_queue_overflow::block;
+    size_t                  high_watermark = 0;     // on_watermark(true, depth) when depth reaches it, 0 = off
+    size_t                  low_watermark = 0;      // on_watermark(false, depth) when depth falls to it after high
+    std::function<void(bool high, size_t depth)> on_watermark;  // called by producer (high) or worker (low), keep it short
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* simple_thread which is awakened by posted jobs, fx receives all jobs posted since last wake up
+ * \note depth is decreased when worker takes jobs to the batch, so up to 2 * capacity jobs exist while fx runs
+ * \note do not post() with block overflow from fx of the same thread, it waits for itself
+ */
+template <class T>
+class simple_queue_thread
+{
+public:
+    simple_queue_thread() = default;
+    /* Create thread with bounded queue, see simple_queue_options */
+    explicit simple_queue_thread(simple_queue_options options)
+        : m_options(std::move(options))
+    {}
+
+    /* Start thread and call your function with drained jobs, when the thread is awakened.
+     * \param[in]  timeout  define timeout when thread should awake (batch is empty when nothing was posted)
+     * \param[in]  fx       function or lambda which will be called when thread is awakened
+     * \param[in]  ...      (optional) additional variadic arguments, which will be passed to fx function
+     * \note fx function has parameters 'simple_thread_context_intf & , std::vector<T> & ', example:
+     *   [&](simple_thread_context_intf & ctx, std::vector<T> & batch) {...}
+     */
+    template <class _Rep, class _Period, class _Fn, class... _Args>
+    std::enable_if_t<internal::is_thread_function_v<std::decay_t<_Fn> &, std::vector<T> &, std::decay_t<_Args> &...>>
+    start(const std::chrono::duration<_Rep, _Period> & timeout, _Fn && fx, _Args&&... ax)
+    {
+        start(simple_thread_options(), timeout, std::forward<_Fn>(fx), std::forward<_Args>(ax)...);
+    }
+
+    /* Same as start(timeout, fx, ...), with additional thread options */
+    template <class _Rep, class _Period, class _Fn, class... _Args>
+    std::enable_if_t<internal::is_thread_function_v<std::decay_t<_Fn> &, std::vector<T> &, std::decay_t<_Args> &...>>
+    start(const simple_thread_options & options, const std::chrono::duration<_Rep, _Period> & timeout, _Fn && fx, _Args&&... ax)
+    {
+        m_closed = false;
+        m_thread.start(options, timeout,
+            [this]() { return has_jobs(); },
+            [this](simple_thread_context & ctx, std::decay_t<_Fn> & fx, std::decay_t<_Args> &... ax) {
+                drain();
+                try {
+                    fx(ctx, m_batch, ax...);
+                }
+                catch (...) {
+                    // jobs were handed to fx, error policy resumes with the next batch only
+                    m_batch.clear();
+                    throw;
+                }
+                m_batch.clear();
+            },
+            std::forward<_Fn>(fx), std::forward<_Args>(ax)...);
+    }
+
+    /* Post one job, any thread
+     * \return  false  when job was not queued (drop_newest / reject overflow, or thread stopped while blocked)
+     */
+    bool post(T && value)
+    {
+        return enqueue(1, m_options.overflow, [&]() { m_queue.push(std::move(value)); });
+    }
+    bool post(const T & value)
+    {
+        return enqueue(1, m_options.overflow, [&]() { m_queue.push(value); });
+    }
+    /* Post jobs [first, last), any thread, with one queue operation and one notify, whole batch is queued or not
+     * \note batch larger than capacity is queued when queue is empty
+     */
+    template <class _It>
+    bool post_batch(_It first, _It last)
+    {
+        if constexpr (!internal::is_forward_iterator_v<_It>) {
+            // counted before push, single pass range is copied
+            std::vector<T> items(first, last);
+            return post_batch(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+        }
+        else {
+            return enqueue(static_cast<size_t>(std::distance(first, last)), m_options.overflow, [&]() { m_queue.push_batch(first, last); });
+        }
+    }
+
+    /* Post job only when there is free capacity, never blocks, any thread
+     * \return  false  when queue is full
+     */
+    bool try_post(T && value)
+    {
+        return enqueue(1, simple_queue_overflow::reject, [&]() { m_queue.push(std::move(value)); });
+    }
+    bool try_post(const T & value)
+    {
+        return enqueue(1, simple_queue_overflow::reject, [&]() { m_queue.push(value); });
+    }
+    template <class _It>
+    bool try_post_batch(_It first, _It last)
+    {
+        if constexpr (!internal::is_forward_iterator_v<_It>) {
+            std::vector<T> items(first, last);
+            return try_post_batch(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+        }
+        else {
+            return enqueue(static_cast<size_t>(std::distance(first, last)), simple_queue_overflow::reject, [&]() { m_queue.push_batch(first, last); });
+        }
+    }
+
+    /* Number of queued jobs (not taken by worker yet), any thread */
+    size_t depth() const
+    {
+        return m_depth.load(std::memory_order_relaxed);
+    }
+
+    /* Stop thread, jobs which were not consumed yet are dropped, blocked producers return false */
+    void stop()
+    {
+        m_closed = true;
+        if (m_space_waiters.load()) {
+            { std::scoped_lock lck(m_space_mutex); }
+            m_space_cv.notify_all();
+        }
+        m_thread.stop();
+    }
+    /* Blocked producers are released and leave wait_for_capacity() before m_space_cv and m_space_mutex are destroyed */
+    ~simple_queue_thread()
+    {
+        stop();
+        std::unique_lock lck(m_space_mutex);
+        m_space_cv.wait(lck, [&]() { return m_space_waiters.load() == 0; });
+    }
+
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+    /* Runtime metrics of the thread, see simple_thread::metrics() */
+    const simple_thread_metrics & metrics() const
+    {
+        return m_thread.metrics();
+    }
+    /* Queue depth and overflow counters, snapshot() can be called from any thread */
+    const simple_queue_metrics & queue_metrics() const
+    {
+        return m_queue_metrics;
+    }
+#endif
+
+private:
+    /* Reserve capacity, push jobs and notify worker */
+    template <class _Push>
+    bool enqueue(size_t count, simple_queue_overflow overflow, _Push && push)
+    {
+        size_t depth = 0;
+        if (m_options.capacity == 0 || overflow == simple_queue_overflow::drop_oldest) {
+            depth = m_depth.fetch_add(count) + count;
+            push();
+            if (m_options.capacity && depth > m_options.capacity) {
+                // watermark and metrics see depth after the drop, it never exceeds capacity
+                depth = drop_oldest();
+            }
+        }
+        else {
+            if (!try_reserve(count, depth)) {
+                if (overflow != simple_queue_overflow::block) {
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+                    (overflow == simple_queue_overflow::drop_newest ? m_queue_metrics.m_dropped : m_queue_metrics.m_rejected)
+                        .fetch_add(count, std::memory_order_relaxed);
+#endif
+                    return false;
+                }
+                if (!wait_for_capacity(count, depth)) {
+                    return false;
+                }
+            }
+            push();
+        }
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+        m_queue_metrics.m_depth.record(depth);
+#endif
+        if (m_options.high_watermark && depth >= m_options.high_watermark && !m_above_high.load(std::memory_order_relaxed)
+            && !m_above_high.exchange(true) && m_options.on_watermark) {
+            m_options.on_watermark(true, depth);
+        }
+        m_thread.notify();
+        return true;
+    }
+
+    /* Increase depth by count when it fits capacity (or queue is empty)
+     * \param[out]  depth   new depth
+     */
+    bool try_reserve(size_t count, size_t & depth)
+    {
+        size_t current = m_depth.load();
+        do {
+            if (current != 0 && current + count > m_options.capacity) {
+                return false;
+            }
+        } while (!m_depth.compare_exchange_weak(current, current + count));
+        depth = current + count;
+        return true;
+    }
+
+    /* Block producer until capacity is free
+     * \return  false  when thread was stopped
+     */
+    bool wait_for_capacity(size_t count, size_t & depth)
+    {
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+        m_queue_metrics.m_blocked.fetch_add(1, std::memory_order_relaxed);
+#endif
+        bool reserved = false;
+        std::unique_lock lck(m_space_mutex);
+        // worker checks m_space_waiters after it decreased depth, so either it notifies or we see new depth
+        m_space_waiters.fetch_add(1);
+        m_space_cv.wait(lck, [&]() { return m_closed || (reserved = try_reserve(count, depth)); });
+        if (m_space_waiters.fetch_sub(1) == 1 && m_closed) {
+            // destructor waits for the last released producer
+            m_space_cv.notify_all();
+        }
+        return reserved;
+    }
+
+    /* drop_oldest overflow, remove jobs over capacity, serialized with worker by m_drop_mutex
+     * \return  depth after the drop, at most capacity
+     */
+    size_t drop_oldest()
+    {
+        std::scoped_lock lck(m_drop_mutex);
+        // push of other producer may not be linked yet, then depth stays over capacity until its own drop_oldest()
+        while (m_depth.load() > m_options.capacity && m_queue.discard()) {
+            m_depth.fetch_sub(1);
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+            m_queue_metrics.m_dropped.fetch_add(1, std::memory_order_relaxed);
+#endif
+        }
+        return std::min(m_depth.load(), m_options.capacity);
+    }
+
+    /* Wake condition of worker */
+    bool has_jobs()
+    {
+        if (m_options.capacity && m_options.overflow == simple_queue_overflow::drop_oldest) {
+            std::scoped_lock lck(m_drop_mutex);
+            return !m_queue.empty();
+        }
+        return !m_queue.empty();
+    }
+
+    /* Move queued jobs to m_batch, worker thread */
+    void drain()
+    {
+        size_t depth = 0;
+        auto take_jobs = [&]() {
+            const size_t count = m_queue.pop_all(m_batch);
+            // producers reserve depth before push, it is never lower than count
+            if (count) {
+                depth = m_depth.fetch_sub(count) - count;
+            }
+            return count;
+        };
+        size_t count = 0;
+        if (m_options.capacity && m_options.overflow == simple_queue_overflow::drop_oldest) {
+            // depth is decreased under the same lock, so drop_oldest() never counts jobs which were already taken
+            std::scoped_lock lck(m_drop_mutex);
+            count = take_jobs();
+        }
+        else {
+            count = take_jobs();
+        }
+        if (count == 0) {
+            return;
+        }
+        if (m_space_waiters.load()) {
+            { std::scoped_lock lck(m_space_mutex); }
+            m_space_cv.notify_all();
+        }
+        if (depth <= m_options.low_watermark && m_above_high.load(std::memory_order_relaxed)
+            && m_above_high.exchange(false) && m_options.on_watermark) {
+            m_options.on_watermark(false, depth);
+        }
+    }
+
+private:
+    simple_queue_options                                m_options;
+    simple_thread_mpsc_queue<T>                         m_queue;
+    std::vector<T>                                      m_batch;    // reused, avoids allocation per wake up
+    SIMPLE_THREAD_CACHE_ALIGN
+    std::atomic<size_t>                                 m_depth = 0;            // reserved by producers before push
+    std::atomic_bool                                    m_above_high = false;   // high watermark reached, low not yet
+    std::atomic_bool                                    m_closed = false;       // stop() was called, blocked producers return
+    std::atomic<size_t>                                 m_space_waiters = 0;    // producers in wait_for_capacity()
+    std::mutex                                          m_space_mutex;          // m_space_cv wait
+    std::condition_variable                             m_space_cv;
+    std::mutex                                          m_drop_mutex;           // serializes drop_oldest() with worker pops
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+    simple_queue_metrics                                m_queue_metrics;
+#endif
+    simple_thread                                       m_thread;   // last, it is stopped before other members are destroyed
+};
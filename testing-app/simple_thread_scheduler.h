@@ -0,0 +1,351 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "simple_thread_wrapper.h"
+
+/* Deadline scheduler, many timed tasks owned by one simple_thread (or simple_pool_thread) worker, thread waits
+ * exactly until the earliest deadline. Tasks are kept in 4-ary min heap, add / cancel / reschedule are O(log n),
+ * task nodes are pooled and task function is stored inline in the node, so there is no allocation per task.
+ * How to use it:
+    {
+        simple_deadline_scheduler<> scheduler;
+        simple_thread test;
+        test.start(
+            std::chrono::milliseconds(0),       // first call immediately, then timeout is set by scheduler
+            [&](simple_thread_context_intf & ctx) {
+                if (first_call) {
+                    // task gets its own id, so it can reschedule itself (periodic task)
+                    scheduler.add(std::chrono::milliseconds(10), [&](simple_deadline_task self) {
+                        send_heartbeat();
+                        scheduler.reschedule(self, std::chrono::milliseconds(10));
+                    });
+                    request_timeout = scheduler.add(std::chrono::seconds(5), [&]() { abort_request(); });
+                }
+                if (response_received) {
+                    scheduler.cancel(request_timeout);
+                }
+                scheduler.run(ctx);     // runs expired tasks, sets timeout to the earliest deadline
+            }
+        );
+    }
+ * \note scheduler is not synchronized, call it only from the worker (thread function), other threads can
+ *   post requests by notify(source) or simple_queue_thread
+ */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Id of task in simple_deadline_scheduler, stays valid until task is cancelled or finishes without reschedule */
+struct simple_deadline_task
+{
+    uint32_t    m_index = UINT32_MAX;
+    uint32_t    m_generation = 0;
+
+    /* Check if id was returned by add() (does not mean the task still exists) */
+    bool valid() const {
+        return m_index != UINT32_MAX;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Scheduler of timed tasks, see How to use it above
+ * \param  _InlineSize  storage for task function (lambda captures) in each node, larger functions are rejected at compile time
+ */
+template <size_t _InlineSize = 48>
+class simple_deadline_scheduler
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    /* Create scheduler
+     * \param[in]  idle_timeout     timeout set to thread context when there is no task
+     * \param[in]  logger           (optional) logger for exceptions of tasks, nullptr means std::cout
+     */
+    explicit simple_deadline_scheduler(clock::duration idle_timeout = std::chrono::seconds(1), simple_thread_logger_intf * logger = nullptr)
+        : m_idle_timeout(idle_timeout)
+        , m_logger(logger)
+    {}
+    ~simple_deadline_scheduler()
+    {
+        for (auto & chunk : m_chunks) {
+            for (size_t index = 0; index < chunk_size; ++index) {
+                if (chunk[index].m_invoke) {
+                    chunk[index].m_destroy(chunk[index].m_storage);
+                }
+            }
+        }
+    }
+
+    /* Add task, O(log n)
+     * \param[in]  deadline     when task should run, deadline in the past runs on next run()
+     * \param[in]  fx           function 'void()', or 'void(simple_deadline_task self)' which can reschedule itself
+     */
+    template <class _Fn>
+    simple_deadline_task add(clock::time_point deadline, _Fn && fx)
+    {
+        using fn_type = std::decay_t<_Fn>;
+        static_assert(sizeof(fn_type) <= _InlineSize && alignof(fn_type) <= alignof(std::max_align_t),
+            "task function does not fit simple_deadline_scheduler node, increase _InlineSize");
+        static_assert(std::is_invocable_v<fn_type &> || std::is_invocable_v<fn_type &, simple_deadline_task>,
+            "task function must be 'void()' or 'void(simple_deadline_task)'");
+
+        const uint32_t index = allocate();
+        node & item = at(index);
+        ::new (static_cast<void *>(item.m_storage)) fn_type(std::forward<_Fn>(fx));
+        item.m_invoke = [](void * storage, simple_deadline_task self) {
+            if constexpr (std::is_invocable_v<fn_type &, simple_deadline_task>) {
+                (*static_cast<fn_type *>(storage))(self);
+            }
+            else {
+                (void)self;
+                (*static_cast<fn_type *>(storage))();
+            }
+        };
+        item.m_destroy = [](void * storage) {
+            static_cast<fn_type *>(storage)->~fn_type();
+        };
+        item.m_deadline = deadline;
+        item.m_sequence = m_sequence++;
+        push(index);
+        return simple_deadline_task{ index, item.m_generation };
+    }
+    /* Same as above, task runs after given delay */
+    template <class _Rep, class _Period, class _Fn>
+    simple_deadline_task add(const std::chrono::duration<_Rep, _Period> & delay, _Fn && fx)
+    {
+        return add(clock::now() + std::chrono::duration_cast<clock::duration>(delay), std::forward<_Fn>(fx));
+    }
+
+    /* Remove task, O(log n), can be called also by the task itself
+     * \return  false  when task does not exist (already finished or cancelled)
+     */
+    bool cancel(simple_deadline_task task)
+    {
+        if (!exists(task)) {
+            return false;
+        }
+        node & item = at(task.m_index);
+        if (item.m_heap_index != not_queued) {
+            remove_at(item.m_heap_index);
+        }
+        if (!item.m_running) {
+            release(task.m_index);
+        }
+        // running task is released when it returns, it is not queued any more
+        return true;
+    }
+
+    /* Move task to new deadline, O(log n), task which is running is scheduled again
+     * \return  false  when task does not exist
+     */
+    bool reschedule(simple_deadline_task task, clock::time_point deadline)
+    {
+        if (!exists(task)) {
+            return false;
+        }
+        node & item = at(task.m_index);
+        item.m_deadline = deadline;
+        item.m_sequence = m_sequence++;
+        if (item.m_heap_index == not_queued) {
+            push(task.m_index);
+        }
+        else {
+            sift_down(sift_up(item.m_heap_index));
+        }
+        return true;
+    }
+    /* Same as above, new deadline is now + delay */
+    template <class _Rep, class _Period>
+    bool reschedule(simple_deadline_task task, const std::chrono::duration<_Rep, _Period> & delay)
+    {
+        return reschedule(task, clock::now() + std::chrono::duration_cast<clock::duration>(delay));
+    }
+
+    /* Run expired tasks, call it from thread function, sets thread timeout to the earliest deadline
+     * \note task rescheduled to the past runs again within the same call
+     */
+    void run(simple_thread_context_intf & ctx)
+    {
+        const auto now = clock::now();
+        while (!m_heap.empty() && at(m_heap.front()).m_deadline <= now) {
+            const uint32_t index = m_heap.front();
+            remove_at(0);
+            node & item = at(index);    // nodes are never moved, reference is valid even when task adds tasks
+            item.m_running = true;
+            try {
+                item.m_invoke(item.m_storage, simple_deadline_task{ index, item.m_generation });
+            }
+            catch (...) {
+                internal::log_message(m_logger, "Exception in scheduled task...");
+            }
+            item.m_running = false;
+            if (item.m_heap_index == not_queued) {
+                release(index);
+            }
+        }
+        if (m_heap.empty()) {
+            ctx.set_timeout(m_idle_timeout);
+        }
+        else {
+            ctx.set_timeout(std::max(at(m_heap.front()).m_deadline - clock::now(), clock::duration::zero()));
+        }
+    }
+
+    /* Get the earliest deadline, time_point::max() when there is no task */
+    clock::time_point next_deadline() const
+    {
+        return m_heap.empty() ? clock::time_point::max() : at(m_heap.front()).m_deadline;
+    }
+    /* Check if task is scheduled (or running) */
+    bool exists(simple_deadline_task task) const
+    {
+        return task.m_index < m_chunks.size() * chunk_size && at(task.m_index).m_invoke
+            && at(task.m_index).m_generation == task.m_generation;
+    }
+    /* Number of scheduled tasks */
+    size_t size() const
+    {
+        return m_heap.size();
+    }
+    bool empty() const
+    {
+        return m_heap.empty();
+    }
+
+private:
+    static constexpr size_t     chunk_size = 64;            // nodes allocated at once
+    static constexpr size_t     arity = 4;                  // children of heap node, 4 children share one cache line of m_heap
+    static constexpr uint32_t   not_queued = UINT32_MAX;
+
+    struct node
+    {
+        clock::time_point       m_deadline;
+        uint64_t                m_sequence = 0;             // FIFO order of equal deadlines
+        uint32_t                m_heap_index = not_queued;
+        uint32_t                m_generation = 0;           // incremented on release, invalidates old ids
+        uint32_t                m_next_free = not_queued;
+        bool                    m_running = false;
+        void                    (*m_invoke)(void *, simple_deadline_task) = nullptr;   // nullptr = free node
+        void                    (*m_destroy)(void *) = nullptr;
+        alignas(std::max_align_t) unsigned char m_storage[_InlineSize];
+    };
+
+    node & at(uint32_t index) {
+        return m_chunks[index / chunk_size][index % chunk_size];
+    }
+    const node & at(uint32_t index) const {
+        return m_chunks[index / chunk_size][index % chunk_size];
+    }
+    bool earlier(uint32_t left, uint32_t right) const
+    {
+        const node & a = at(left);
+        const node & b = at(right);
+        return a.m_deadline != b.m_deadline ? a.m_deadline < b.m_deadline : a.m_sequence < b.m_sequence;
+    }
+
+    uint32_t allocate()
+    {
+        if (m_free == not_queued) {
+            const uint32_t first = static_cast<uint32_t>(m_chunks.size() * chunk_size);
+            m_chunks.push_back(std::make_unique<node[]>(chunk_size));
+            for (size_t index = chunk_size; index > 0; --index) {
+                m_chunks.back()[index - 1].m_next_free = m_free;
+                m_free = first + static_cast<uint32_t>(index - 1);
+            }
+        }
+        const uint32_t index = m_free;
+        m_free = at(index).m_next_free;
+        return index;
+    }
+    void release(uint32_t index)
+    {
+        node & item = at(index);
+        item.m_destroy(item.m_storage);
+        item.m_invoke = nullptr;
+        item.m_destroy = nullptr;
+        ++item.m_generation;
+        item.m_next_free = m_free;
+        m_free = index;
+    }
+
+    void push(uint32_t index)
+    {
+        at(index).m_heap_index = static_cast<uint32_t>(m_heap.size());
+        m_heap.push_back(index);
+        sift_up(m_heap.size() - 1);
+    }
+    void remove_at(size_t position)
+    {
+        at(m_heap[position]).m_heap_index = not_queued;
+        const uint32_t last = m_heap.back();
+        m_heap.pop_back();
+        if (position < m_heap.size()) {
+            m_heap[position] = last;
+            at(last).m_heap_index = static_cast<uint32_t>(position);
+            sift_down(sift_up(position));
+        }
+    }
+    void place(size_t position, uint32_t index)
+    {
+        m_heap[position] = index;
+        at(index).m_heap_index = static_cast<uint32_t>(position);
+    }
+    /* \return  new position of the element */
+    size_t sift_up(size_t position)
+    {
+        const uint32_t index = m_heap[position];
+        while (position > 0) {
+            const size_t parent = (position - 1) / arity;
+            if (!earlier(index, m_heap[parent])) {
+                break;
+            }
+            place(position, m_heap[parent]);
+            position = parent;
+        }
+        place(position, index);
+        return position;
+    }
+    void sift_down(size_t position)
+    {
+        const uint32_t index = m_heap[position];
+        while (true) {
+            const size_t first_child = position * arity + 1;
+            if (first_child >= m_heap.size()) {
+                break;
+            }
+            size_t best = first_child;
+            const size_t last_child = std::min(first_child + arity, m_heap.size());
+            for (size_t child = first_child + 1; child < last_child; ++child) {
+                if (earlier(m_heap[child], m_heap[best])) {
+                    best = child;
+                }
+            }
+            if (!earlier(m_heap[best], index)) {
+                break;
+            }
+            place(position, m_heap[best]);
+            position = best;
+        }
+        place(position, index);
+    }
+
+private:
+    simple_deadline_scheduler(const simple_deadline_scheduler &) = delete;
+    simple_deadline_scheduler & operator=(const simple_deadline_scheduler &) = delete;
+
+private:
+    clock::duration                         m_idle_timeout;
+    simple_thread_logger_intf *             m_logger;
+    std::vector<std::unique_ptr<node[]>>    m_chunks;       // node pool, nodes keep their address
+    std::vector<uint32_t>                   m_heap;         // node indexes, 4-ary min heap by deadline
+    uint32_t                                m_free = not_queued;
+    uint64_t                                m_sequence = 0;
+};
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/* Hierarchical timing wheel, used by simple_thread_pool to drive timeouts of all its workloads from one timer thread.
+ * Timer nodes are intrusive (embedded in your object), so schedule/cancel is O(1) and does not allocate.
+ * The wheel is not synchronized, owner must protect it by its own mutex.
+ * How to use it:
+    {
+        struct my_timer : simple_thread_timer_node { int id = 0; };
+
+        simple_thread_timer_wheel wheel(std::chrono::milliseconds(1));
+        my_timer timer;
+        wheel.schedule(timer, std::chrono::steady_clock::now() + std::chrono::seconds(1));
+
+        // timer thread
+        std::this_thread::sleep_until(wheel.next_expiry());
+        wheel.advance(std::chrono::steady_clock::now(), [](simple_thread_timer_node & node) {
+            std::cout << " Expired " << static_cast<my_timer &>(node).id << "\n";
+        });
+    }
+ */
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Intrusive timer node, embed (derive) it into object you want to schedule */
+class simple_thread_timer_node
+{
+public:
+    simple_thread_timer_node() = default;
+    /* Check if node is scheduled in the wheel */
+    bool is_armed() const {
+        return m_next != nullptr;
+    }
+
+private:
+    friend class simple_thread_timer_wheel;
+    simple_thread_timer_node(const simple_thread_timer_node &) = delete;
+    simple_thread_timer_node & operator=(const simple_thread_timer_node &) = delete;
+
+private:
+    simple_thread_timer_node *  m_prev = nullptr;
+    simple_thread_timer_node *  m_next = nullptr;
+    uint64_t                    m_expiry_tick = 0;
+    uint16_t                    m_level = 0;
+    uint16_t                    m_slot = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Internal helper functions */
+namespace internal {
+    inline unsigned count_trailing_zeros(uint64_t value)
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index = 0;
+        _BitScanForward64(&index, value);
+        return index;
+#elif defined(_MSC_VER)
+        unsigned long index = 0;
+        if (_BitScanForward(&index, static_cast<unsigned long>(value))) {
+            return index;
+        }
+        _BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+        return index + 32;
+#else
+        return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Four levels of 256 slots, with 1ms resolution it covers ~49 days, longer timers are re-cascaded
+ */
+class simple_thread_timer_wheel
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    /* Create empty wheel
+     * \param[in]  resolution  length of one tick, timers never fire earlier than scheduled, but up to one tick later
+     */
+    explicit simple_thread_timer_wheel(clock::duration resolution = std::chrono::milliseconds(1))
+        : m_resolution(resolution.count() > 0 ? resolution : clock::duration(1))
+        , m_origin(clock::now())
+    {
+        for (auto & level : m_slots) {
+            for (auto & slot : level) {
+                slot.m_prev = slot.m_next = &slot;
+            }
+        }
+    }
+
+    /* Schedule (or re-arm already scheduled) node to given deadline, O(1) */
+    void schedule(simple_thread_timer_node & node, clock::time_point deadline)
+    {
+        unlink(node);
+        uint64_t tick = m_current + 1;
+        if (deadline > m_origin) {
+            // round up, timer must not fire before its deadline
+            tick = std::max(tick, static_cast<uint64_t>((deadline - m_origin + m_resolution - clock::duration(1)) / m_resolution));
+        }
+        node.m_expiry_tick = tick;
+        link(node);
+    }
+
+    /* Remove node from the wheel, O(1), does nothing when node is not scheduled */
+    void cancel(simple_thread_timer_node & node)
+    {
+        unlink(node);
+    }
+
+    /* Fire all timers which expired until now
+     * \param[in]  now          current time
+     * \param[in]  on_expired   function called for each expired node ('simple_thread_timer_node &'), node is already
+     *                          removed from the wheel, so it can be re-scheduled from the callback
+     */
+    template <class _Fn>
+    void advance(clock::time_point now, _Fn && on_expired)
+    {
+        if (now < m_origin) {
+            return;
+        }
+        const uint64_t target = static_cast<uint64_t>((now - m_origin) / m_resolution);
+        while (m_count > 0)
+        {
+            // jump over empty ticks
+            const uint64_t tick = next_tick();
+            if (tick > target) {
+                break;
+            }
+            m_current = tick;
+            for (unsigned level = levels - 1; level > 0; --level) {
+                if ((tick & ((uint64_t(1) << (slot_bits * level)) - 1)) == 0) {
+                    cascade(level, slot_index(tick, level));
+                }
+            }
+
+            simple_thread_timer_node & head = m_slots[0][slot_index(tick, 0)];
+            while (head.m_next != &head) {
+                simple_thread_timer_node & node = *head.m_next;
+                unlink(node);
+                on_expired(node);
+            }
+        }
+        m_current = std::max(m_current, target);
+    }
+
+    /* Get time when advance() should be called next time, time_point::max() when wheel is empty */
+    clock::time_point next_expiry() const
+    {
+        const uint64_t tick = next_tick();
+        if (tick == UINT64_MAX) {
+            return clock::time_point::max();
+        }
+        return m_origin + m_resolution * tick;
+    }
+
+    /* Check if there is no scheduled timer */
+    bool empty() const
+    {
+        return m_count == 0;
+    }
+
+private:
+    static constexpr unsigned levels = 4;
+    static constexpr unsigned slot_bits = 8;
+    static constexpr unsigned slot_count = 1u << slot_bits;
+
+    static unsigned slot_index(uint64_t tick, unsigned level)
+    {
+        return static_cast<unsigned>(tick >> (slot_bits * level)) & (slot_count - 1);
+    }
+
+    /* Get nearest tick which fires or cascades some timer, UINT64_MAX when wheel is empty */
+    uint64_t next_tick() const
+    {
+        if (m_count == 0) {
+            return UINT64_MAX;
+        }
+        for (unsigned level = 0; level < levels; ++level) {
+            const unsigned shift = slot_bits * level;
+            const unsigned distance = find_slot(level, slot_index(m_current, level), level == levels - 1);
+            if (distance != 0) {
+                return ((m_current >> shift) + distance) << shift;
+            }
+        }
+        return UINT64_MAX;
+    }
+
+    /* Find distance of the nearest non-empty slot after 'current_slot', 0 when not found */
+    unsigned find_slot(unsigned level, unsigned current_slot, bool wrap) const
+    {
+        const unsigned limit = wrap ? slot_count - 1 : slot_count - 1 - current_slot;
+        for (unsigned distance = 1; distance <= limit; ) {
+            const unsigned slot = (current_slot + distance) & (slot_count - 1);
+            const uint64_t word = m_bitmap[level][slot / 64] >> (slot % 64);
+            if (word != 0) {
+                distance += internal::count_trailing_zeros(word);
+                return distance <= limit ? distance : 0;
+            }
+            distance += 64 - slot % 64;
+        }
+        return 0;
+    }
+
+    void link(simple_thread_timer_node & node)
+    {
+        // lower levels hold only timers of current rotation of the upper level, top level is circular
+        unsigned level = 0;
+        uint64_t slot_tick = std::max(node.m_expiry_tick, m_current);
+        while (level < levels - 1 && (slot_tick >> (slot_bits * (level + 1))) != (m_current >> (slot_bits * (level + 1)))) {
+            ++level;
+        }
+        if (level == levels - 1 && (slot_tick >> (slot_bits * level)) - (m_current >> (slot_bits * level)) >= slot_count) {
+            // out of wheel range, park it in the last slot of top level, it will be re-cascaded
+            slot_tick = m_current + ((uint64_t(slot_count) - 1) << (slot_bits * level));
+        }
+
+        const unsigned slot = slot_index(slot_tick, level);
+        simple_thread_timer_node & head = m_slots[level][slot];
+        node.m_level = static_cast<uint16_t>(level);
+        node.m_slot = static_cast<uint16_t>(slot);
+        node.m_prev = head.m_prev;
+        node.m_next = &head;
+        head.m_prev->m_next = &node;
+        head.m_prev = &node;
+        m_bitmap[level][slot / 64] |= uint64_t(1) << (slot % 64);
+        ++m_count;
+    }
+
+    void unlink(simple_thread_timer_node & node)
+    {
+        if (!node.is_armed()) {
+            return;
+        }
+        node.m_prev->m_next = node.m_next;
+        node.m_next->m_prev = node.m_prev;
+        simple_thread_timer_node & head = m_slots[node.m_level][node.m_slot];
+        if (head.m_next == &head) {
+            m_bitmap[node.m_level][node.m_slot / 64] &= ~(uint64_t(1) << (node.m_slot % 64));
+        }
+        node.m_prev = node.m_next = nullptr;
+        --m_count;
+    }
+
+    /* Move timers of upper level slot to lower levels */
+    void cascade(unsigned level, unsigned slot)
+    {
+        simple_thread_timer_node & head = m_slots[level][slot];
+        while (head.m_next != &head) {
+            simple_thread_timer_node & node = *head.m_next;
+            unlink(node);
+            link(node);
+        }
+    }
+
+private:
+    simple_thread_timer_wheel(const simple_thread_timer_wheel &) = delete;
+    simple_thread_timer_wheel & operator=(const simple_thread_timer_wheel &) = delete;
+
+private:
+    clock::duration             m_resolution;
+    clock::time_point           m_origin;
+    uint64_t                    m_current = 0;      // last processed tick
+    size_t                      m_count = 0;
+    simple_thread_timer_node    m_slots[levels][slot_count];
+    uint64_t                    m_bitmap[levels][slot_count / 64] = {};
+};
@@ -0,0 +1,331 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/* Timeline tracing of simple_thread workers, recorded only when SIMPLE_THREAD_ENABLE_TRACE is defined before
+ * including simple_thread_wrapper.h (or by compiler option), otherwise trace hooks are compiled out.
+ * Every thread writes compact binary events (16 bytes) to its own ring buffer (no lock, oldest events are
+ * overwritten), write_chrome_trace() dumps all rings as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+ * Recorded sections: wait (spin / park / poll), coalesce, lock (m_thread_mutex acquisition after wait and
+ * after ctx.unlock()), fx, unlocked (ctx.unlock() / scoped_unlock()); instant events: notify, notify_wake
+ * (notify which had to wake parked worker).
+ * How to use it:
+    {
+        simple_thread_tracer::instance().enable(true);
+
+        simple_thread test;
+        test.start(std::chrono::seconds(1), [&](simple_thread_context_intf & ctx) {...});
+
+        // later, any thread
+        std::ofstream out("trace.json");
+        simple_thread_tracer::instance().write_chrome_trace(out);
+    }
+ * \note SIMPLE_THREAD_TRACE_RING_SIZE sets events kept per thread (default 4096, power of 2)
+ * \note ring of exited thread is reused by new thread after it was dumped, SIMPLE_THREAD_TRACE_MAX_THREADS
+ *   (default 1024) limits number of rings, over it new thread reuses ring of exited thread which was not dumped yet,
+ *   or its events are dropped when all threads with ring are still running
+ */
+
+#if !defined(SIMPLE_THREAD_TRACE_RING_SIZE)
+#define SIMPLE_THREAD_TRACE_RING_SIZE 4096
+#endif
+#if !defined(SIMPLE_THREAD_TRACE_MAX_THREADS)
+#define SIMPLE_THREAD_TRACE_MAX_THREADS 1024
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Traced sections and events */
+enum class simple_trace_event : uint8_t
+{
+    wait,
+    coalesce,
+    lock,
+    fx,
+    unlocked,
+    notify,
+    notify_wake,
+};
+
+/* Phase of event, same as Chrome trace 'ph' */
+enum class simple_trace_phase : uint8_t
+{
+    begin,
+    end,
+    instant,
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Process wide collector of trace events, disabled until enable(true) */
+class simple_thread_tracer
+{
+public:
+    /* Tracer instance, never destroyed, threads can record also during static destruction */
+    static simple_thread_tracer & instance()
+    {
+        static simple_thread_tracer * const tracer = new simple_thread_tracer();
+        return *tracer;
+    }
+
+    /* Start or stop recording, any thread, recorded events are kept */
+    void enable(bool enabled)
+    {
+        m_enabled.store(enabled, std::memory_order_relaxed);
+    }
+    bool enabled() const
+    {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    /* Record event of calling thread, one clock reading and three stores, no lock after the first call of thread */
+    void record(simple_trace_event event, simple_trace_phase phase)
+    {
+        if (!m_enabled.load(std::memory_order_relaxed)) {
+            return;
+        }
+        ring * buffer = thread_ring();
+        if (!buffer) {
+            return;
+        }
+        const uint64_t head = buffer->m_head.load(std::memory_order_relaxed);
+        slot & item = buffer->m_slots[head & (ring_size - 1)];
+        item.m_time.store(static_cast<uint64_t>((std::chrono::steady_clock::now() - m_origin).count()), std::memory_order_relaxed);
+        item.m_event.store((static_cast<uint32_t>(event) << 8) | static_cast<uint32_t>(phase), std::memory_order_relaxed);
+        buffer->m_head.store(head + 1, std::memory_order_release);
+    }
+
+    /* Name of calling thread in trace, e.g. simple_thread_attributes::name */
+    void set_thread_name(const std::string & name)
+    {
+        ring * buffer = thread_ring();
+        if (!buffer) {
+            return;
+        }
+        std::scoped_lock lck(m_rings_mutex);
+        buffer->m_name = name;
+    }
+
+    /* Write events of all threads as Chrome trace JSON, any thread, events recorded meanwhile may be missing */
+    void write_chrome_trace(std::ostream & out)
+    {
+        std::scoped_lock lck(m_rings_mutex);
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        for (const auto & buffer : m_rings) {
+            // ring of thread which exited before the dump can be reused after it
+            const bool exited = buffer->m_exited.load(std::memory_order_acquire);
+            if (!buffer->m_name.empty()) {
+                out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->m_tid
+                    << ",\"args\":{\"name\":\"";
+                write_escaped(out, buffer->m_name);
+                out << "\"}}";
+                first = false;
+            }
+
+            const uint64_t head = buffer->m_head.load(std::memory_order_acquire);
+            uint64_t index = head > ring_size ? head - ring_size : 0;
+            std::vector<std::pair<uint64_t, uint32_t>> events;
+            events.reserve(static_cast<size_t>(head - index));
+            for (; index != head; ++index) {
+                const slot & item = buffer->m_slots[index & (ring_size - 1)];
+                events.emplace_back(item.m_time.load(std::memory_order_relaxed), item.m_event.load(std::memory_order_relaxed));
+            }
+            // slots overwritten by the owner while they were read are dropped
+            const uint64_t last_head = buffer->m_head.load(std::memory_order_acquire);
+            const uint64_t valid_from = last_head >= ring_size ? last_head - ring_size + 1 : 0;
+            const uint64_t read_from = head > ring_size ? head - ring_size : 0;
+            size_t depth = 0;
+            for (size_t position = valid_from > read_from ? static_cast<size_t>(valid_from - read_from) : 0; position < events.size(); ++position) {
+                const auto phase = static_cast<simple_trace_phase>(events[position].second & 0xff);
+                const auto event = static_cast<simple_trace_event>(events[position].second >> 8);
+                if (phase == simple_trace_phase::begin) {
+                    ++depth;
+                }
+                else if (phase == simple_trace_phase::end) {
+                    // ring starts in the middle of section
+                    if (depth == 0) {
+                        continue;
+                    }
+                    --depth;
+                }
+
+                const uint64_t time = events[position].first;
+                out << (first ? "" : ",") << "\n{\"name\":\"" << event_name(event) << "\",\"ph\":\""
+                    << (phase == simple_trace_phase::begin ? "B" : phase == simple_trace_phase::end ? "E" : "i")
+                    << "\",\"ts\":" << time / 1000 << '.' << static_cast<char>('0' + time / 100 % 10)
+                    << static_cast<char>('0' + time / 10 % 10) << static_cast<char>('0' + time % 10)
+                    << ",\"pid\":1,\"tid\":" << buffer->m_tid << (phase == simple_trace_phase::instant ? ",\"s\":\"t\"}" : "}");
+                first = false;
+            }
+            buffer->m_dumped = exited;
+        }
+        out << "\n]}\n";
+    }
+
+    /* Drop recorded events, call it when no thread records (e.g. before enable(true)) */
+    void clear()
+    {
+        std::scoped_lock lck(m_rings_mutex);
+        for (auto & buffer : m_rings) {
+            buffer->m_head.store(0, std::memory_order_relaxed);
+            buffer->m_dumped = buffer->m_exited.load(std::memory_order_acquire);
+        }
+    }
+
+    /* Number of allocated rings (threads which recorded events, exited threads whose rings were not reused) */
+    size_t ring_count()
+    {
+        std::scoped_lock lck(m_rings_mutex);
+        return m_rings.size();
+    }
+
+    static const char * event_name(simple_trace_event event)
+    {
+        switch (event) {
+        case simple_trace_event::wait:          return "wait";
+        case simple_trace_event::coalesce:      return "coalesce";
+        case simple_trace_event::lock:          return "lock";
+        case simple_trace_event::fx:            return "fx";
+        case simple_trace_event::unlocked:      return "unlocked";
+        case simple_trace_event::notify:        return "notify";
+        case simple_trace_event::notify_wake:   return "notify_wake";
+        }
+        return "unknown";
+    }
+
+private:
+    static constexpr uint64_t   ring_size = SIMPLE_THREAD_TRACE_RING_SIZE;
+    static constexpr size_t     max_rings = SIMPLE_THREAD_TRACE_MAX_THREADS;
+    static_assert((ring_size & (ring_size - 1)) == 0, "SIMPLE_THREAD_TRACE_RING_SIZE must be power of 2");
+
+    struct slot
+    {
+        std::atomic<uint64_t>   m_time = 0;     // ns since m_origin
+        std::atomic<uint32_t>   m_event = 0;    // event << 8 | phase
+    };
+    /* Events of one thread, single writer (owner thread) */
+    struct ring
+    {
+        explicit ring(uint32_t tid)
+            : m_tid(tid)
+            , m_slots(std::make_unique<slot[]>(ring_size))
+        {}
+        std::atomic<uint64_t>   m_head = 0;     // events written so far
+        std::atomic_bool        m_exited = false;   // owner thread ended, it does not write any more
+        uint32_t                m_tid;          // protected by m_rings_mutex, new tid when ring is reused
+        std::string             m_name;         // protected by m_rings_mutex
+        bool                    m_dumped = false;   // protected by m_rings_mutex, events of exited owner were written
+        std::unique_ptr<slot[]> m_slots;
+    };
+    /* Marks ring of calling thread exited when the thread ends */
+    struct ring_owner
+    {
+        ring **                 m_slot = nullptr;
+        ~ring_owner()
+        {
+            if (m_slot && *m_slot) {
+                (*m_slot)->m_exited.store(true, std::memory_order_release);
+                *m_slot = nullptr;
+            }
+        }
+    };
+
+    simple_thread_tracer() = default;
+
+    /* Get ring of calling thread, registration (mutex) is done only on the first call from each thread
+     * \return  nullptr  when events of calling thread are dropped (no free ring, or thread is exiting)
+     */
+    ring * thread_ring()
+    {
+        // trivially destructible, still valid when thread records after t_owner was destroyed
+        thread_local ring * t_ring = nullptr;
+        thread_local bool t_registered = false;
+        if (!t_registered) {
+            t_registered = true;
+            t_ring = acquire_ring();
+            if (t_ring) {
+                thread_local ring_owner t_owner;
+                t_owner.m_slot = &t_ring;
+            }
+        }
+        return t_ring;
+    }
+
+    /* Reuse dumped ring of exited thread, then allocate new one, over max_rings reuse any ring of exited thread */
+    ring * acquire_ring()
+    {
+        std::scoped_lock lck(m_rings_mutex);
+        ring * reused = nullptr;
+        for (const auto & buffer : m_rings) {
+            if (buffer->m_exited.load(std::memory_order_acquire)) {
+                if (buffer->m_dumped) {
+                    reused = buffer.get();
+                    break;
+                }
+                if (!reused && m_rings.size() >= max_rings) {
+                    reused = buffer.get();
+                }
+            }
+        }
+        if (!reused) {
+            if (m_rings.size() >= max_rings) {
+                return nullptr;
+            }
+            m_rings.push_back(std::make_unique<ring>(++m_last_tid));
+            return m_rings.back().get();
+        }
+        reused->m_head.store(0, std::memory_order_relaxed);
+        reused->m_tid = ++m_last_tid;
+        reused->m_name.clear();
+        reused->m_dumped = false;
+        reused->m_exited.store(false, std::memory_order_relaxed);
+        return reused;
+    }
+
+    static void write_escaped(std::ostream & out, const std::string & text)
+    {
+        for (const char ch : text) {
+            if (ch == '"' || ch == '\\') {
+                out << '\\' << ch;
+            }
+            else if (static_cast<unsigned char>(ch) >= 0x20) {
+                out << ch;
+            }
+        }
+    }
+
+private:
+    simple_thread_tracer(const simple_thread_tracer &) = delete;
+    simple_thread_tracer & operator=(const simple_thread_tracer &) = delete;
+
+private:
+    std::atomic_bool                        m_enabled = false;
+    const std::chrono::steady_clock::time_point m_origin = std::chrono::steady_clock::now();
+    std::mutex                              m_rings_mutex;      // protects: m_rings, ring::m_name
+    std::vector<std::unique_ptr<ring>>      m_rings;            // rings of exited threads are kept until dumped (or max_rings)
+    uint32_t                                m_last_tid = 0;     // protected by m_rings_mutex
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Trace hooks used by simple_thread */
+#if defined(SIMPLE_THREAD_ENABLE_TRACE)
+#define SIMPLE_THREAD_TRACE_BEGIN(event)        simple_thread_tracer::instance().record(simple_trace_event::event, simple_trace_phase::begin)
+#define SIMPLE_THREAD_TRACE_END(event)          simple_thread_tracer::instance().record(simple_trace_event::event, simple_trace_phase::end)
+#define SIMPLE_THREAD_TRACE_INSTANT(event)      simple_thread_tracer::instance().record(simple_trace_event::event, simple_trace_phase::instant)
+#define SIMPLE_THREAD_TRACE_THREAD_NAME(name)   simple_thread_tracer::instance().set_thread_name(name)
+#else
+#define SIMPLE_THREAD_TRACE_BEGIN(event)        ((void)0)
+#define SIMPLE_THREAD_TRACE_END(event)          ((void)0)
+#define SIMPLE_THREAD_TRACE_INSTANT(event)      ((void)0)
+#define SIMPLE_THREAD_TRACE_THREAD_NAME(name)   ((void)0)
+#endif
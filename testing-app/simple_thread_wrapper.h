@@ -1,9 +1,27 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <tuple>
 #include <type_traits>
+#include <utility>
+#include <vector>
 #include "helper.h"
+#include "simple_thread_attributes.h"
+#include "simple_thread_error.h"
+#include "simple_thread_executor.h"
+#include "simple_thread_log.h"
+#include "simple_thread_metrics.h"
+#include "simple_thread_trace.h"
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 /* Simple thread wrapper provide basic thread functionality when you need create your own thread 
  * How to use it:
@@ -53,6 +71,11 @@
                 invode_my_external_callback();
                 // put unlocked mutex back to clocked state (not need to called explicitly as destructor will handle this for us)
                 unlock_holder.reset();
+
+                // same without heap allocation, e.g. when you unlock on every wake up
+                auto unlock_guard = ctx.scoped_unlock();
+                invode_my_external_callback();
+                unlock_guard.reset();
             },
             std::move(my_additional_param) // We can pass other parameters to thread function
         );
@@ -68,6 +91,43 @@
         // simulate run
         std::this_thread::sleep_for(std::chrono::seconds(5));
     }
+
+    --- Sample 3:
+    {
+        simple_thread_options options;
+        options.schedule = simple_thread_schedule::fixed_rate;  // wake every 1ms without drift
+        options.overrun = simple_thread_overrun::skip;          // when fx takes longer, skip missed periods
+
+        simple_thread test;
+        test.start(
+            options,
+            std::chrono::milliseconds(1),
+            [&](simple_thread_context_intf & ctx) {
+                take_sample();
+            }
+        );
+    }
+
+    --- Sample 4:
+    {
+        enum event_source : unsigned { config_changed = 0, data_ready = 1 };
+
+        simple_thread test;
+        test.start(
+            std::chrono::seconds(1),
+            [&](simple_thread_context_intf & ctx) {
+                // each source is one bit, no predicate is evaluated to find out what happened
+                if (ctx.was_woken_by(config_changed)) {
+                    reload_config();
+                }
+                if (ctx.was_woken_by(data_ready)) {
+                    process_data();
+                }
+            }
+        );
+
+        test.notify(data_ready);
+    }
  */
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -81,8 +141,132 @@ public:
 /* Unlocker holder, holds unlocked mutex, for example when you need invoke callback in your thread function */
 using simple_thread_unlock_holder = std::unique_ptr<simple_thread_unlock_holder_intf>;
 
+/* Unlock guard, holds unlocked mutex same as simple_thread_unlock_holder, but it is movable value type without
+ * heap allocation and virtual destructor. Mutex is locked back on reset() or when guard is destroyed.
+ */
+class simple_thread_unlock_guard
+{
+public:
+    simple_thread_unlock_guard() = default;
+    explicit simple_thread_unlock_guard(std::unique_lock<std::mutex> & lock)
+        : m_lock(&lock)
+    {
+        m_lock->unlock();
+        SIMPLE_THREAD_TRACE_BEGIN(unlocked);
+    }
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+    /* Same as above, time until mutex is locked back is added to unlocked_time */
+    simple_thread_unlock_guard(std::unique_lock<std::mutex> & lock, std::chrono::steady_clock::duration * unlocked_time)
+        : simple_thread_unlock_guard(lock)
+    {
+        m_unlocked_time = unlocked_time;
+        m_unlock_start = std::chrono::steady_clock::now();
+    }
+#endif
+    simple_thread_unlock_guard(simple_thread_unlock_guard && other) noexcept
+        : m_lock(std::exchange(other.m_lock, nullptr))
+    {
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+        m_unlocked_time = std::exchange(other.m_unlocked_time, nullptr);
+        m_unlock_start = other.m_unlock_start;
+#endif
+    }
+    simple_thread_unlock_guard & operator=(simple_thread_unlock_guard && other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            m_lock = std::exchange(other.m_lock, nullptr);
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+            m_unlocked_time = std::exchange(other.m_unlocked_time, nullptr);
+            m_unlock_start = other.m_unlock_start;
+#endif
+        }
+        return *this;
+    }
+    ~simple_thread_unlock_guard()
+    {
+        reset();
+    }
+    /* Lock mutex back */
+    void reset()
+    {
+        if (m_lock) {
+            SIMPLE_THREAD_TRACE_END(unlocked);
+            SIMPLE_THREAD_TRACE_BEGIN(lock);
+            m_lock->lock();
+            SIMPLE_THREAD_TRACE_END(lock);
+            m_lock = nullptr;
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+            if (m_unlocked_time) {
+                *m_unlocked_time += std::chrono::steady_clock::now() - m_unlock_start;
+                m_unlocked_time = nullptr;
+            }
+#endif
+        }
+    }
+    /* Check if guard still holds unlocked mutex */
+    explicit operator bool() const
+    {
+        return m_lock != nullptr;
+    }
+private:
+    simple_thread_unlock_guard(const simple_thread_unlock_guard &) = delete;
+    simple_thread_unlock_guard & operator=(const simple_thread_unlock_guard &) = delete;
+private:
+    std::unique_lock<std::mutex> * m_lock = nullptr;
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+    std::chrono::steady_clock::duration * m_unlocked_time = nullptr;
+    std::chrono::steady_clock::time_point m_unlock_start;
+#endif
+};
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/* Stop token, allows your thread function to check stop request without locking, e.g. in long running loop */
+class simple_thread_stop_token
+{
+public:
+    simple_thread_stop_token() = default;
+    explicit simple_thread_stop_token(const std::atomic_bool * stop_flag)
+        : m_stop_flag(stop_flag)
+    {}
+    /* Check if stop was requested */
+    bool stop_requested() const
+    {
+        return m_stop_flag && m_stop_flag->load(std::memory_order_acquire);
+    }
+    /* Check if token is associated with some thread */
+    bool stop_possible() const
+    {
+        return m_stop_flag != nullptr;
+    }
+private:
+    const std::atomic_bool *    m_stop_flag = nullptr;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* Number of wake sources of one thread, see simple_thread::notify(unsigned source) */
+inline constexpr unsigned simple_thread_wake_source_count = 64;
+
+/* Native I/O handle, file descriptor on POSIX, HANDLE on Windows, see simple_io_thread */
+#if defined(_WIN32)
+using simple_io_handle = void *;
+#else
+using simple_io_handle = int;
+#endif
+/* simple_io_event::events flags */
+inline constexpr uint32_t simple_io_read = 1;       // readable (Windows: handle is signalled)
+inline constexpr uint32_t simple_io_write = 2;      // writable
+inline constexpr uint32_t simple_io_error = 4;      // error or hang up
+
+/* I/O handle which is ready */
+struct simple_io_event
+{
+    simple_io_handle    handle;
+    uint32_t            events;     // simple_io_read, simple_io_write, simple_io_error flags
+};
+
 /* Interface for update thread parameters during your thread function */
 class simple_thread_context_intf
 {
@@ -97,6 +281,44 @@ public:
     virtual void set_timeout(const std::chrono::steady_clock::duration & duration) = 0;
     /* Allows unlock simple_thread mutex, for example in your thread function you need invoke callback and you do not want deadlock */
     [[nodiscard]] virtual simple_thread_unlock_holder unlock() = 0;
+    /* Same as unlock(), but returns value type guard, without heap allocation */
+    [[nodiscard]] virtual simple_thread_unlock_guard scoped_unlock() = 0;
+    /* Get number of notify() calls merged into this wake up (since previous fx call) */
+    virtual uint64_t get_notify_count() = 0;
+    /* Check if thread stop was requested, lock-free, long running thread function should poll it and return */
+    virtual bool stop_requested() = 0;
+    /* Get stop token, which can be polled also from other functions called by your thread function */
+    virtual simple_thread_stop_token get_stop_token() = 0;
+    /* Run task on executor (simple_thread_options::executor), or immediately when there is no executor */
+    virtual void spawn(std::function<void()> task) = 0;
+    /* Wait for tasks spawned by this call of thread function (helps to run them), rethrows first exception of tasks
+     * \note it is also called after thread function returned (or threw), tasks are then reported as its error,
+     *   but locals of thread function are already destroyed, so tasks which refer to them must be waited by wait_all()
+     *   before thread function returns
+     */
+    virtual void wait_all() = 0;
+    /* Get wake sources signalled by notify(source) since previous fx call, bit N is set for source N */
+    virtual uint64_t get_wake_sources() = 0;
+    /* Get I/O handles which are ready, filled only by simple_io_thread, otherwise empty */
+    virtual const std::vector<simple_io_event> & get_io_events() = 0;
+    /* Get time when thread was scheduled to wake by timeout (deadline of the wait) */
+    virtual std::chrono::steady_clock::time_point get_scheduled_time() = 0;
+    /* Get time when thread woke up (just before fx call) */
+    virtual std::chrono::steady_clock::time_point get_wake_time() = 0;
+    /* Get duration of previous fx call, zero on the first call */
+    virtual std::chrono::steady_clock::duration get_previous_duration() = 0;
+    /* Get number of periods (timeouts) whose deadline passed without own fx call: skipped or coalesced in fixed_rate
+     * schedule (late periods called back to back by burst overrun are not missed), or in relative schedule whole
+     * timeouts elapsed between scheduled and actual timeout wake up, 0 when on time */
+    virtual uint64_t get_missed_periods() = 0;
+    /* Helper function, how late the thread woke up after its scheduled time, negative when woken earlier (by notify) */
+    std::chrono::steady_clock::duration get_lateness() {
+        return get_wake_time() - get_scheduled_time();
+    }
+    /* Helper function, check if given wake source was signalled */
+    bool was_woken_by(unsigned source) {
+        return source < simple_thread_wake_source_count && (get_wake_sources() & (uint64_t(1) << source)) != 0;
+    }
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -110,19 +332,39 @@ namespace internal {
             : m_lock(lock)
         {
             m_lock.unlock();
+            SIMPLE_THREAD_TRACE_BEGIN(unlocked);
         }
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+        simple_thread_unlock_holder_impl(std::unique_lock<std::mutex> & lock, std::chrono::steady_clock::duration * unlocked_time)
+            : simple_thread_unlock_holder_impl(lock)
+        {
+            m_unlocked_time = unlocked_time;
+        }
+#endif
         virtual ~simple_thread_unlock_holder_impl()
         {
+            SIMPLE_THREAD_TRACE_END(unlocked);
+            SIMPLE_THREAD_TRACE_BEGIN(lock);
             m_lock.lock();
+            SIMPLE_THREAD_TRACE_END(lock);
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+            if (m_unlocked_time) {
+                *m_unlocked_time += std::chrono::steady_clock::now() - m_unlock_start;
+            }
+#endif
         }
     private:
         simple_thread_unlock_holder_impl & operator=(const simple_thread_unlock_holder_impl &) = delete;
         simple_thread_unlock_holder_impl(const simple_thread_unlock_holder &) = delete;
     private:
         std::unique_lock<std::mutex> & m_lock;
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+        std::chrono::steady_clock::duration * m_unlocked_time = nullptr;
+        std::chrono::steady_clock::time_point m_unlock_start = std::chrono::steady_clock::now();
+#endif
     };
 
-    class simple_thread_context : public simple_thread_context_intf
+    class simple_thread_context final : public simple_thread_context_intf
     {
     public:
         bool was_timeout() override {
@@ -142,13 +384,74 @@ namespace internal {
             set_timeout((std::chrono::steady_clock::duration)timeout);
         };
 
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+        [[nodiscard]] simple_thread_unlock_holder unlock() override {
+            return std::make_unique<simple_thread_unlock_holder_impl>(m_lock_holder, &m_unlocked_time);
+        }
+        [[nodiscard]] simple_thread_unlock_guard scoped_unlock() override {
+            return simple_thread_unlock_guard(m_lock_holder, &m_unlocked_time);
+        }
+#else
         [[nodiscard]] simple_thread_unlock_holder unlock() override {
             return std::make_unique<simple_thread_unlock_holder_impl>(m_lock_holder);
         }
+        [[nodiscard]] simple_thread_unlock_guard scoped_unlock() override {
+            return simple_thread_unlock_guard(m_lock_holder);
+        }
+#endif
+        uint64_t get_notify_count() override {
+            return m_notify_count;
+        }
+        bool stop_requested() override {
+            return m_stop_token.stop_requested();
+        }
+        simple_thread_stop_token get_stop_token() override {
+            return m_stop_token;
+        }
+        void spawn(std::function<void()> task) override {
+            spawn<std::function<void()>>(std::move(task));
+        }
+        /* Same as above, without std::function */
+        template <class _Fn>
+        void spawn(_Fn && task) {
+            if (m_executor) {
+                m_executor->spawn(m_tasks, std::forward<_Fn>(task));
+            }
+            else {
+                task();
+            }
+        }
+        void wait_all() override {
+            if (m_executor) {
+                m_executor->wait(m_tasks);
+            }
+        }
+        uint64_t get_wake_sources() override {
+            return m_wake_sources;
+        }
+        const std::vector<simple_io_event> & get_io_events() override {
+            static const std::vector<simple_io_event> no_events;
+            return m_io_events ? *m_io_events : no_events;
+        }
+        std::chrono::steady_clock::time_point get_scheduled_time() override {
+            return m_scheduled_time;
+        }
+        std::chrono::steady_clock::time_point get_wake_time() override {
+            return m_wake_time;
+        }
+        std::chrono::steady_clock::duration get_previous_duration() override {
+            return m_previous_duration;
+        }
+        uint64_t get_missed_periods() override {
+            return m_missed_periods;
+        }
 
         /// Non interface functions
-        simple_thread_context(std::unique_lock<std::mutex> & lock_holder)
+        simple_thread_context(std::unique_lock<std::mutex> & lock_holder, const std::atomic_bool * stop_flag = nullptr,
+            simple_thread_executor * executor = nullptr)
             : m_lock_holder(lock_holder)
+            , m_stop_token(stop_flag)
+            , m_executor(executor)
         {}
         void set_was_timeout(bool was_timeout) {
             m_was_timeout = was_timeout;
@@ -156,11 +459,263 @@ namespace internal {
         auto get_new_timeout() {
             return m_duration;
         }
+        void set_notify_count(uint64_t notify_count) {
+            m_notify_count = notify_count;
+        }
+        void set_wake_sources(uint64_t wake_sources) {
+            m_wake_sources = wake_sources;
+        }
+        void set_io_events(const std::vector<simple_io_event> * io_events) {
+            m_io_events = io_events;
+        }
+        /* Set timing of wake up, missed periods are computed from was_timeout and timeout, so call it after them
+         * \param[in]  skipped_periods  periods skipped (or coalesced) by fixed_rate schedule since previous call
+         * \param[in]  fixed_rate       periods elapsed while thread was late are handled (and counted in skipped_periods)
+         *                              by fixed_rate overrun policy, so lateness is not counted
+         */
+        void set_timing(std::chrono::steady_clock::time_point scheduled_time, std::chrono::steady_clock::time_point wake_time,
+            std::chrono::steady_clock::duration previous_duration, uint64_t skipped_periods = 0, bool fixed_rate = false)
+        {
+            m_scheduled_time = scheduled_time;
+            m_wake_time = wake_time;
+            m_previous_duration = previous_duration;
+            m_missed_periods = skipped_periods;
+            if (!fixed_rate && m_was_timeout && m_duration > std::chrono::steady_clock::duration::zero() && wake_time > scheduled_time) {
+                m_missed_periods += static_cast<uint64_t>((wake_time - scheduled_time) / m_duration);
+            }
+        }
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+        /* Time spent in unlock() / scoped_unlock() sections, which already ended */
+        std::chrono::steady_clock::duration get_unlocked_time() const {
+            return m_unlocked_time;
+        }
+#endif
 
     private:
         std::unique_lock<std::mutex> & m_lock_holder;
+        simple_thread_stop_token m_stop_token;
+        simple_thread_executor * m_executor = nullptr;
+        simple_task_group m_tasks;
         bool m_was_timeout = false;
+        uint64_t m_notify_count = 0;
+        uint64_t m_wake_sources = 0;
+        const std::vector<simple_io_event> * m_io_events = nullptr;
+        std::chrono::steady_clock::time_point m_scheduled_time;
+        std::chrono::steady_clock::time_point m_wake_time;
+        std::chrono::steady_clock::duration m_previous_duration = std::chrono::nanoseconds(0);
+        uint64_t m_missed_periods = 0;
         std::chrono::steady_clock::duration m_duration = std::chrono::nanoseconds(0);
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+        std::chrono::steady_clock::duration m_unlocked_time = std::chrono::nanoseconds(0);
+#endif
+    };
+
+    /* Type erased simple_thread workload, run() returns when the workload is stopped
+     * \param[in]  reused   OS thread already ran other workload
+     */
+    class simple_thread_workload
+    {
+    public:
+        virtual ~simple_thread_workload() {};
+        virtual void run(bool reused) = 0;
+    };
+    template <class _Fn>
+    class simple_thread_workload_impl final : public simple_thread_workload
+    {
+    public:
+        explicit simple_thread_workload_impl(_Fn && fx)
+            : m_fx(std::move(fx))
+        {}
+        void run(bool reused) override {
+            m_fx(reused);
+        }
+    private:
+        _Fn     m_fx;
+    };
+
+    /* fx accepts interface, or concrete context (opt-in for calls without virtual dispatch) */
+    template <class _Fn, class... _Args>
+    inline constexpr bool is_thread_function_v =
+        std::is_invocable_r_v<void, _Fn, simple_thread_context_intf &, _Args...> ||
+        std::is_invocable_r_v<void, _Fn, simple_thread_context &, _Args...>;
+}
+
+/* Concrete context passed to fx, when fx takes 'simple_thread_context &' (or 'auto &') instead of
+ * 'simple_thread_context_intf &', calls of was_timeout, set_timeout, ... are not virtual and can be inlined
+ */
+using simple_thread_context = internal::simple_thread_context;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/* How timeout wakeups are scheduled */
+enum class simple_thread_schedule
+{
+    relative,       // wait timeout after fx returns (default), period drifts by fx execution time
+    fixed_rate,     // wait until absolute deadline, advanced by timeout (period) on every timeout wakeup
+};
+
+/* What to do in fixed_rate schedule, when fx runs longer than the period and deadlines are missed */
+enum class simple_thread_overrun
+{
+    skip,           // drop missed periods, wait for next deadline of the original grid
+    burst,          // call fx for every missed period back to back
+    coalesce,       // call fx once immediately for all missed periods, then continue on the original grid
+};
+
+/* How thread waits for wake up */
+enum class simple_thread_wait
+{
+    park,           // block on condition variable (default)
+    spin_then_park, // spin up to spin_duration, then block, lower wakeup latency for cost of CPU time
+    busy_spin,      // never block, spin until wake up or timeout, burns whole core
+};
+
+/* What stop() does with OS thread */
+enum class simple_thread_stop_mode
+{
+    join,           // end OS thread (default)
+    park,           // keep OS thread waiting for next start(), restart does not create new thread
+};
+
+/* What worker does after fx throws */
+enum class simple_thread_error_policy
+{
+    resume,         // continue as if fx returned (default)
+    stop,           // end thread (same as request_stop()), e.g. with simple_thread_error_future
+    backoff,        // next wake up by timeout is delayed 2x, 4x, ... of the timeout up to error_backoff_max, reset by successful fx
+};
+
+/* Optional simple_thread parameters */
+struct simple_thread_options
+{
+    simple_thread_schedule  schedule = simple_thread_schedule::relative;
+    simple_thread_overrun   overrun = simple_thread_overrun::skip;
+    /* Wakeup coalescing, after wake up by pred thread waits up to coalesce_window (or until coalesce_count
+     * notify() calls are pending) before fx is called, so burst of notifications is handled by one fx call.
+     * Zero coalesce_window disables it, zero coalesce_count means wait for whole window.
+     */
+    std::chrono::steady_clock::duration coalesce_window = std::chrono::steady_clock::duration::zero();
+    uint64_t                coalesce_count = 0;
+    /* Wait strategy, while spinning notify() is only one atomic operation and fx is called without kernel wake up */
+    simple_thread_wait      wait = simple_thread_wait::park;
+    std::chrono::steady_clock::duration spin_duration = std::chrono::microseconds(50);   // spin budget of spin_then_park
+    bool                    spin_yield = false;     // spin by std::this_thread::yield() instead of cpu pause instruction
+    /* Logger for stop and exception messages, nullptr means std::cout, logger must outlive the thread */
+    simple_thread_logger_intf * logger = nullptr;
+    /* Exceptions of fx, error_sink (when set) gets them instead of logger, sink must outlive the thread */
+    simple_thread_error_policy  error_policy = simple_thread_error_policy::resume;
+    simple_thread_error_sink_intf * error_sink = nullptr;
+    std::chrono::steady_clock::duration error_backoff_max = std::chrono::seconds(30);
+    /* OS thread attributes (name, affinity, priority, stack size, NUMA node) */
+    simple_thread_attributes attributes;
+    /* Executor running tasks of ctx.spawn(), nullptr means tasks run immediately, executor must outlive the thread */
+    simple_thread_executor * executor = nullptr;
+};
+
+/* Internal helper functions */
+namespace internal {
+    /* Log message by given logger, or to std::cout when no logger is set */
+    inline void log_message(simple_thread_logger_intf * logger, const char * message)
+    {
+        if (logger) {
+            logger->log(message);
+        }
+        else {
+            simple_thread_console_logger().log(message);
+        }
+    }
+
+    /* Hint CPU we are in spin loop */
+    inline void cpu_relax()
+    {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        __asm__ __volatile__("yield");
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    /* Get number of periods between deadline and next deadline, which are not fired (skip and coalesce overrun) */
+    inline uint64_t skipped_periods(std::chrono::steady_clock::time_point deadline, std::chrono::steady_clock::time_point next,
+        std::chrono::steady_clock::duration period)
+    {
+        if (period <= std::chrono::steady_clock::duration::zero() || next <= deadline + period) {
+            return 0;
+        }
+        return static_cast<uint64_t>((next - deadline - period) / period);
+    }
+
+    /* Report exception of fx by error sink (or logger), caller must not hold m_thread_mutex
+     * \param[in]  failures    consecutive failed fx calls, including this one
+     * \return  minimal wait before next fx call (backoff policy), zero otherwise
+     */
+    inline std::chrono::steady_clock::duration report_error(const simple_thread_options & options, const std::exception_ptr & error,
+        uint64_t failures, std::chrono::steady_clock::duration timeout)
+    {
+        if (options.error_sink) {
+            options.error_sink->report(error);
+        }
+        else {
+            log_message(options.logger, "Exception in thread procedure...");
+        }
+        if (options.error_policy != simple_thread_error_policy::backoff) {
+            return std::chrono::steady_clock::duration::zero();
+        }
+        auto delay = std::max<std::chrono::steady_clock::duration>(timeout, std::chrono::milliseconds(1));
+        for (uint64_t index = 0; index < failures && delay < options.error_backoff_max; ++index) {
+            delay *= 2;
+        }
+        return std::min(delay, options.error_backoff_max);
+    }
+
+    /* Get next fixed_rate deadline after timeout wakeup */
+    inline std::chrono::steady_clock::time_point next_deadline(std::chrono::steady_clock::time_point deadline,
+        std::chrono::steady_clock::duration period, simple_thread_overrun overrun,
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now())
+    {
+        if (period <= std::chrono::steady_clock::duration::zero()) {
+            return now;
+        }
+        deadline += period;
+        if (deadline > now || overrun == simple_thread_overrun::burst) {
+            return deadline;
+        }
+        // number of whole periods missed
+        const auto missed = (now - deadline) / period;
+        if (overrun == simple_thread_overrun::coalesce) {
+            return deadline + missed * period;      // last missed deadline, fires immediately
+        }
+        return deadline + (missed + 1) * period;
+    }
+
+    /* Default wait backend of simple_thread loop, worker blocks on m_thread_cv. Backend is copied into the workload,
+     * simple_io_thread runs the same loop with backend which blocks in OS readiness wait.
+     */
+    class simple_thread_cv_wait
+    {
+    public:
+        static constexpr bool can_spin = true;      // simple_thread_wait spin strategies apply
+
+        /* Wait with m_thread_mutex held by lck, same semantic as condition_variable::wait_until with predicate */
+        template <class _WakePred>
+        bool wait_until(std::unique_lock<std::mutex> & lck, std::condition_variable & cv,
+            std::chrono::steady_clock::time_point wait_end, _WakePred & wake_pred)
+        {
+            return cv.wait_until(lck, wait_end, wake_pred);
+        }
+        /* Pass results of the last wait to fx context */
+        void set_context(simple_thread_context &) {}
+    };
+
+    /* Wakes worker blocked in other wait backend than simple_thread_cv_wait */
+    class simple_thread_waker_intf
+    {
+    public:
+        virtual ~simple_thread_waker_intf() {};
+        /* Called by notify() / request_stop() of any thread, when worker waits (or is going to wait) in the backend */
+        virtual void wake() = 0;
     };
 }
 
@@ -171,19 +726,24 @@ namespace internal {
 class simple_thread
 {
 public:
-    
+    simple_thread() = default;
+
     /* Start thread and call your function, with additional arguments, when then thread is awakened.
      * \param[in]  timeout  define timeout when thread should awake
      * \param[in]  fx       function or lambda which will be called when thread is awakened
      * \param[in]  ...      (optional) additional variadic arguments, which will be passed to fx function
      * \note fx function has first parameter 'simple_thread_context_intf & ', example:
      *   [&](simple_thread_context_intf & ctx) {...}
+     *   or 'simple_thread_context & ' to avoid virtual calls, example:
+     *   [&](simple_thread_context & ctx) {...}
+     * \note fx, pred and arguments are copied (or moved, so they can be move-only) into the thread, same as by
+     *   std::thread, and passed to fx as lvalues on every call, use std::ref to pass a reference
      */
     template <class _Rep, class _Period, class _Fn, class... _Args>
-    std::enable_if_t<std::is_invocable_r_v<void, _Fn, simple_thread_context_intf &, _Args...>>
+    std::enable_if_t<internal::is_thread_function_v<std::decay_t<_Fn> &, std::decay_t<_Args> &...>>
     start(const std::chrono::duration<_Rep, _Period> & timeout, _Fn && fx, _Args&&... ax)
     {
-        start(timeout, [] { return false; }, fx, std::forward<_Args>(ax)...);
+        start(timeout, [] { return false; }, std::forward<_Fn>(fx), std::forward<_Args>(ax)...);
     }
 
     /* Start thread and call your function, with additional arguments, when then thread is awakened.
@@ -193,67 +753,402 @@ public:
      * \param[in]  ...      (optional) additional variadic arguments, which will be passed to fx function
      * \note fx function has first parameter 'simple_thread_context_intf & ', example:
      *   [&](simple_thread_context_intf & ctx) {...}
+     *   or 'simple_thread_context & ' to avoid virtual calls, example:
+     *   [&](simple_thread_context & ctx) {...}
+     * \note fx, pred and arguments are copied (or moved, so they can be move-only) into the thread, same as by
+     *   std::thread, and passed to fx as lvalues on every call, use std::ref to pass a reference
      */
     template <class _Rep, class _Period, class _Predicate, class _Fn, class... _Args>
-    std::enable_if_t<std::is_invocable_r_v<bool, _Predicate> && std::is_invocable_r_v<void, _Fn, simple_thread_context_intf &, _Args...>>
+    std::enable_if_t<std::is_invocable_r_v<bool, _Predicate &> && internal::is_thread_function_v<std::decay_t<_Fn> &, std::decay_t<_Args> &...>>
     start(const std::chrono::duration<_Rep, _Period> & timeout, _Predicate pred, _Fn && fx, _Args&&... ax)
     {
-        m_thread = std::thread([&]() {
-            std::chrono::steady_clock::duration thread_timeout = timeout;
+        start(simple_thread_options(), timeout, std::move(pred), std::forward<_Fn>(fx), std::forward<_Args>(ax)...);
+    }
+
+    /* Same as start(timeout, fx, ...), with additional thread options
+     * \param[in]  options  (optional) thread parameters, e.g. fixed rate schedule
+     */
+    template <class _Rep, class _Period, class _Fn, class... _Args>
+    std::enable_if_t<internal::is_thread_function_v<std::decay_t<_Fn> &, std::decay_t<_Args> &...>>
+    start(const simple_thread_options & options, const std::chrono::duration<_Rep, _Period> & timeout, _Fn && fx, _Args&&... ax)
+    {
+        start(options, timeout, [] { return false; }, std::forward<_Fn>(fx), std::forward<_Args>(ax)...);
+    }
+
+    /* Same as start(timeout, pred, fx, ...), with additional thread options
+     * \param[in]  options  (optional) thread parameters, e.g. fixed rate schedule
+     * \note in fixed_rate schedule timeout (or value from set_timeout) is the period, wakeups by pred do not move the deadline
+     */
+    template <class _Rep, class _Period, class _Predicate, class _Fn, class... _Args>
+    std::enable_if_t<std::is_invocable_r_v<bool, _Predicate &> && internal::is_thread_function_v<std::decay_t<_Fn> &, std::decay_t<_Args> &...>>
+    start(const simple_thread_options & options, const std::chrono::duration<_Rep, _Period> & timeout, _Predicate pred, _Fn && fx, _Args&&... ax)
+    {
+        start_workload(options, timeout, internal::simple_thread_cv_wait(), std::move(pred), std::forward<_Fn>(fx), std::forward<_Args>(ax)...);
+    }
+
+    /* Request thread stop and return immediately (do not wait for the thread end), lock-free while fx is running,
+     * when you need stop many threads, call request_stop() on all of them first, then stop()
+     * \note workload ends, OS thread is parked until next start() or stop()
+     */
+    void request_stop()
+    {
+        m_thread_stop.store(true);
+        // same as notify(), also wakes spinning and coalescing worker
+        const uint64_t prev = m_wake_state.fetch_add(wake_notified);
+        if (prev & wake_parked) {
+            wake_parked_worker();
+        }
+        else if (prev & wake_coalescing) {
+            { std::scoped_lock lck(m_thread_mutex); }
+            m_thread_cv.notify_one();
+        }
+    }
+    /* Stop thread, waits for the thread end
+     * \param[in]  mode     (optional) simple_thread_stop_mode::park keeps OS thread for next start(), which then
+     *                      only hands it new workload
+     */
+    void stop(simple_thread_stop_mode mode = simple_thread_stop_mode::join)
+    {
+        request_stop();
+        if (!m_thread.joinable()) {
+            return;
+        }
+        std::unique_lock lck(m_thread_mutex);
+        if (mode == simple_thread_stop_mode::park) {
+            m_park_cv.wait(lck, [&]() { return !m_workload_running; });
+            return;
+        }
+        m_thread_exit = true;
+        lck.unlock();
+        m_park_cv.notify_all();
+        m_thread.join();
+        m_thread_exit = false;
+    }
+    /* Notify used with external
+     * \note when thread is running fx (not waiting) it is just one atomic operation
+     */
+    void notify()
+    {
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+        // notify latency is measured from the first notification which was not handled yet
+        if (m_metrics.m_notify_time.load(std::memory_order_relaxed) == 0) {
+            int64_t expected = 0;
+            m_metrics.m_notify_time.compare_exchange_strong(expected,
+                std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+        }
+#endif
+        SIMPLE_THREAD_TRACE_INSTANT(notify);
+        const uint64_t prev = m_wake_state.fetch_add(wake_notified);
+        if (prev & wake_parked) {
+            SIMPLE_THREAD_TRACE_INSTANT(notify_wake);
+            wake_parked_worker();
+        }
+        // coalescing worker is woken only by the notify which reaches its target count
+        else if ((prev & wake_coalescing) && prev / wake_notified + 1 == m_coalesce_target.load()) {
+            SIMPLE_THREAD_TRACE_INSTANT(notify_wake);
+            { std::scoped_lock lck(m_thread_mutex); }
+            m_thread_cv.notify_one();
+        }
+    }
+    /* Notify by one of independent wake sources (e.g. event types), fx gets signalled sources by
+     * ctx.get_wake_sources() / ctx.was_woken_by(source), so pred is not needed to find out what happened
+     * \param[in]  source   index of wake source, 0 - 63 (simple_thread_wake_source_count - 1), other values are ignored
+     * \note several notify(source) calls before fx runs are merged into one mask, same as notify()
+     */
+    void notify(unsigned source)
+    {
+        if (source < simple_thread_wake_source_count) {
+            m_wake_sources.fetch_or(uint64_t(1) << source);
+            notify();
+        }
+    }
+    ~simple_thread()
+    {
+        stop();
+    }
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+    /* Runtime metrics of this thread, snapshot() can be called from any thread */
+    const simple_thread_metrics & metrics() const
+    {
+        return m_metrics;
+    }
+#endif
+
+private:
+    friend class simple_io_thread;
+
+    /* Thread which waits in other backend than m_thread_cv, notify() slow path wakes it by waker, see simple_io_thread */
+    explicit simple_thread(internal::simple_thread_waker_intf * waker)
+        : m_waker(waker)
+    {}
+
+    /* Run thread loop with given wait backend on parked or new OS thread, see internal::simple_thread_cv_wait */
+    template <class _Wait, class _Predicate, class _Fn, class... _Args>
+    void start_workload(const simple_thread_options & options, std::chrono::steady_clock::duration first_timeout, _Wait wait,
+        _Predicate pred, _Fn && fx, _Args&&... ax)
+    {
+        // workload owns copies of all parameters of this function
+        auto workload = [this, options, first_timeout, wait = std::move(wait), pred = std::move(pred),
+            fx = std::decay_t<_Fn>(std::forward<_Fn>(fx)), args = std::tuple<std::decay_t<_Args>...>(std::forward<_Args>(ax)...)](bool reused) mutable {
+            // parked OS thread still has attributes of previous workload
+            internal::apply_thread_attributes(options.attributes, [&](const char * message) {
+                internal::log_message(options.logger, message);
+            }, reused);
+            if (!options.attributes.name.empty()) {
+                SIMPLE_THREAD_TRACE_THREAD_NAME(options.attributes.name);
+            }
+            std::chrono::steady_clock::duration thread_timeout = first_timeout;
+            const bool fixed_rate = options.schedule == simple_thread_schedule::fixed_rate;
+            // fx_end is also base of next relative timeout, so there is one clock reading before and one after fx
+            auto fx_end = std::chrono::steady_clock::now();
+            auto deadline = fx_end + thread_timeout;
+            auto fx_duration = std::chrono::steady_clock::duration::zero();
+            auto error_delay = std::chrono::steady_clock::duration::zero();     // backoff after exception of fx
+            uint64_t failures = 0;
+            uint64_t skipped_periods = 0;
+            uint64_t seen_notify_count = 0;
             while (true)
             {
+                SIMPLE_THREAD_TRACE_BEGIN(lock);
                 std::unique_lock lck(m_thread_mutex);
+                SIMPLE_THREAD_TRACE_END(lock);
+
+                internal::simple_thread_context ctx(lck, &m_thread_stop, options.executor);
+                // signalled wake source wakes without evaluating pred
+                auto wake_pred = [&]() {
+                    return m_wake_sources.load() != 0 || pred() || m_thread_stop;
+                };
+                // fixed_rate deadline stays wait end (scheduled time) also when fx overran it, only error backoff moves it
+                const auto scheduled_time = fixed_rate ? deadline : fx_end + thread_timeout;
+                const auto wait_end = error_delay > std::chrono::steady_clock::duration::zero() ? std::max(scheduled_time, fx_end + error_delay) : scheduled_time;
+                bool wait_res = false;
+                SIMPLE_THREAD_TRACE_BEGIN(wait);
+                if constexpr (_Wait::can_spin) {
+                    if (options.wait != simple_thread_wait::park && !wake_pred()) {
+                        wait_res = spin_wait(lck, options, wait_end, wake_pred);
+                    }
+                }
+                if (!wait_res) {
+                    // from now notify() must take the slow path (mutex + condition variable, or m_waker)
+                    m_wake_state.fetch_or(wake_parked);
+                    wait_res = wait.wait_until(lck, m_thread_cv, wait_end, wake_pred);
+                    m_wake_state.fetch_and(~wake_parked);
+                }
+                SIMPLE_THREAD_TRACE_END(wait);
 
-                internal::simple_thread_context ctx(lck);
-                auto wait_res = m_thread_cv.wait_for(lck, thread_timeout, [&]() {
-                    return pred() || m_thread_stop;
-                });
+                if (wait_res && !m_thread_stop && options.coalesce_window > std::chrono::steady_clock::duration::zero()) {
+                    SIMPLE_THREAD_TRACE_BEGIN(coalesce);
+                    coalesce_wakeups(lck, options, seen_notify_count);
+                    SIMPLE_THREAD_TRACE_END(coalesce);
+                }
 
                 // stop was signalled, end loop
                 if (m_thread_stop) {
-                    std::cout << log_time() << " Stop requested\n";
+                    internal::log_message(options.logger, "Stop requested");
                     return;
                 }
 
                 ctx.set_was_timeout(!wait_res);
                 ctx.set_timeout(thread_timeout);
+                const uint64_t notify_count = m_wake_state.load() / wake_notified;
+                ctx.set_notify_count(notify_count - seen_notify_count);
+                seen_notify_count = notify_count;
+                ctx.set_wake_sources(m_wake_sources.exchange(0));
+                wait.set_context(ctx);
+                const auto fx_start = std::chrono::steady_clock::now();
+                ctx.set_timing(wait_end, fx_start, fx_duration, std::exchange(skipped_periods, 0), fixed_rate);
 
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+                (wait_res ? m_metrics.m_pred_wakeups : m_metrics.m_timeout_wakeups).fetch_add(1, std::memory_order_relaxed);
+                if (const int64_t notify_time = m_metrics.m_notify_time.exchange(0, std::memory_order_relaxed)) {
+                    m_metrics.m_notify_latency.record(fx_start.time_since_epoch() - std::chrono::steady_clock::duration(notify_time));
+                }
+#endif
+                std::exception_ptr error;
+                SIMPLE_THREAD_TRACE_BEGIN(fx);
                 try {
-                    fx(ctx, std::forward<_Args>(ax)...);
+                    std::apply([&](auto &... ax) { fx(ctx, ax...); }, args);
                 }
                 catch (...) {
-                    std::cout << log_time() << " Exception in thread procedure...\n";
+                    error = std::current_exception();
                 }
+                // implicit wait_all(), before error is handled, so exception of a task is reported as error of fx call
+                try {
+                    ctx.wait_all();
+                }
+                catch (...) {
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+                if (error) {
+                    m_metrics.m_exceptions.fetch_add(1, std::memory_order_relaxed);
+                }
+#endif
+                SIMPLE_THREAD_TRACE_END(fx);
+                fx_end = std::chrono::steady_clock::now();
+                fx_duration = fx_end - fx_start;
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+                m_metrics.m_fx_duration.record(fx_duration);
+                m_metrics.m_lock_hold.record(fx_duration - ctx.get_unlocked_time());
+                m_metrics.m_unlocked.record(ctx.get_unlocked_time());
+#endif
                 thread_timeout = ctx.get_new_timeout();
+                if (fixed_rate && !wait_res) {
+                    const auto next = internal::next_deadline(deadline, thread_timeout, options.overrun, fx_end);
+                    skipped_periods += internal::skipped_periods(deadline, next, thread_timeout);
+                    deadline = next;
+                }
+                failures = error ? failures + 1 : 0;
+                error_delay = std::chrono::steady_clock::duration::zero();
+                if (error) {
+                    // sink runs without m_thread_mutex, notify() / request_stop() slow path does not wait for it
+                    lck.unlock();
+                    error_delay = internal::report_error(options, error, failures, thread_timeout);
+                    if (options.error_policy == simple_thread_error_policy::stop) {
+                        m_thread_stop = true;
+                        return;
+                    }
+                }
             }
-        });
+        };
+        run_workload(options.attributes.stack_size, std::make_unique<internal::simple_thread_workload_impl<decltype(workload)>>(std::move(workload)));
     }
 
-    /* Stop thread */
-    void stop()
+    /* Stop current workload and run new one, on parked OS thread when there is one with the same stack size */
+    void run_workload(size_t stack_size, std::unique_ptr<internal::simple_thread_workload> workload)
     {
-        {
-            std::scoped_lock lck(m_thread_mutex);
-            m_thread_stop = true;
+        const bool reuse = m_thread.joinable() && stack_size == m_thread_stack_size;
+        stop(reuse ? simple_thread_stop_mode::park : simple_thread_stop_mode::join);
+
+        std::unique_lock lck(m_thread_mutex);
+        m_thread_stop = false;
+        m_wake_state = 0;
+        m_wake_sources = 0;
+        m_next_workload = std::move(workload);
+        m_workload_running = true;
+        if (reuse) {
+            lck.unlock();
+            m_park_cv.notify_all();
+            return;
         }
-        m_thread_cv.notify_one();
-        if (m_thread.joinable()) {
-            m_thread.join();
+        lck.unlock();
+        m_thread_stack_size = stack_size;
+        m_thread = internal::simple_native_thread(stack_size, [this]() { thread_proc(); });
+    }
+
+    /* OS thread procedure, runs workloads until stop(simple_thread_stop_mode::join) */
+    void thread_proc()
+    {
+        std::unique_lock lck(m_thread_mutex);
+        for (bool reused = false; ; reused = true)
+        {
+            m_park_cv.wait(lck, [&]() { return m_next_workload || m_thread_exit; });
+            if (!m_next_workload) {
+                return;
+            }
+            auto workload = std::move(m_next_workload);
+            lck.unlock();
+
+            workload->run(reused);
+            workload.reset();   // fx and its arguments are destroyed before stop() returns
+
+            lck.lock();
+            m_workload_running = false;
+            m_park_cv.notify_all();
         }
     }
-    /* Notify used with external  */
-    void notify()
+
+    /* Wake worker which waits in backend (wake_parked flag is set) */
+    void wake_parked_worker()
     {
+        if (m_waker) {
+            m_waker->wake();
+            return;
+        }
+        // worker is waiting (or just going to), mutex guarantees it already waits or will re-check pred
+        { std::scoped_lock lck(m_thread_mutex); }
         m_thread_cv.notify_one();
     }
-    ~simple_thread()
+
+    /* Spin until notify() makes wake_pred true, or spin budget expires, called with m_thread_mutex held
+     * \return  true  when wake_pred is met
+     */
+    template <class _WakePred>
+    bool spin_wait(std::unique_lock<std::mutex> & lck, const simple_thread_options & options,
+        std::chrono::steady_clock::time_point wait_end, _WakePred & wake_pred)
     {
-        stop();
+        auto spin_end = wait_end;
+        if (options.wait == simple_thread_wait::spin_then_park) {
+            spin_end = std::min(wait_end, std::chrono::steady_clock::now() + options.spin_duration);
+        }
+        uint64_t seen_state = m_wake_state.load() & ~(wake_parked | wake_coalescing);
+        lck.unlock();
+        for (unsigned spin = 1; ; ++spin) {
+            if (options.spin_yield) {
+                std::this_thread::yield();
+            }
+            else {
+                internal::cpu_relax();
+            }
+            const uint64_t state = m_wake_state.load(std::memory_order_acquire) & ~(wake_parked | wake_coalescing);
+            if (state != seen_state) {
+                seen_state = state;
+                lck.lock();
+                if (wake_pred()) {
+                    return true;
+                }
+                lck.unlock();
+            }
+            // do not read clock on every spin
+            if (spin % 64 == 0 && std::chrono::steady_clock::now() >= spin_end) {
+                break;
+            }
+        }
+        lck.lock();
+        return false;
+    }
+
+    /* Wait for more notifications, called with m_thread_mutex held */
+    void coalesce_wakeups(std::unique_lock<std::mutex> & lck, const simple_thread_options & options, uint64_t seen_notify_count)
+    {
+        const auto window_end = std::chrono::steady_clock::now() + options.coalesce_window;
+        const uint64_t target = options.coalesce_count ? seen_notify_count + options.coalesce_count : UINT64_MAX;
+        m_coalesce_target.store(target);
+        m_wake_state.fetch_or(wake_coalescing);
+        m_thread_cv.wait_until(lck, window_end, [&]() {
+            return m_thread_stop || m_wake_state.load() / wake_notified >= target;
+        });
+        m_wake_state.fetch_and(~wake_coalescing);
     }
 
 private:
-    std::mutex                  m_thread_mutex;          // protects: m_thread_stop
-    std::thread                 m_thread;
-    bool                        m_thread_stop = false;
+    static constexpr uint64_t   wake_parked = 1;         // m_wake_state flag, worker waits on m_thread_cv (or in backend of m_waker)
+    static constexpr uint64_t   wake_coalescing = 2;     // m_wake_state flag, worker waits for m_coalesce_target notifications
+    static constexpr uint64_t   wake_notified = 4;       // m_wake_state increment, notify counter
+
+private:
+    /// Worker side, mutex is locked by worker on every wake up, other threads touch it only on notify slow path
+    SIMPLE_THREAD_CACHE_ALIGN
+    std::mutex                  m_thread_mutex;          // held while fx runs, m_thread_cv wait, protects: m_next_workload, m_workload_running, m_thread_exit
     std::condition_variable     m_thread_cv;
+    internal::simple_native_thread m_thread;
+    std::condition_variable     m_park_cv;               // parked OS thread waits for workload, stop() for workload end
+    std::unique_ptr<internal::simple_thread_workload> m_next_workload;   // handed to OS thread by start()
+    bool                        m_workload_running = false;
+    bool                        m_thread_exit = false;   // OS thread ends, set by stop(simple_thread_stop_mode::join)
+    size_t                      m_thread_stack_size = 0; // stack size of current OS thread
+
+    /// Producer side, written by notify() / request_stop() of any thread
+    SIMPLE_THREAD_CACHE_ALIGN
+    std::atomic<uint64_t>       m_wake_state = 0;        // wake_parked, wake_coalescing flags + notify counter
+    std::atomic<uint64_t>       m_wake_sources = 0;      // mask of sources signalled by notify(source), taken by worker before fx
+    std::atomic<uint64_t>       m_coalesce_target = 0;   // notify counter value which ends coalescing
+    std::atomic_bool            m_thread_stop = false;
+    internal::simple_thread_waker_intf * const m_waker = nullptr;    // wakes worker parked in other backend than m_thread_cv
+#if defined(SIMPLE_THREAD_ENABLE_METRICS)
+    SIMPLE_THREAD_CACHE_ALIGN
+    simple_thread_metrics       m_metrics;
+#endif
 };